@@ -0,0 +1,615 @@
+/*
+  ==============================================================================
+
+    Benchmarks for the SimpleEQ DSP code.
+
+        SimpleEQBenchmarks [--filter <name>] [--json <file>]
+
+        --filter <name>   only run the benchmarks whose name contains 'name'
+        --json <file>     also write every measurement to 'file', one entry
+                          per benchmark and configuration, so two commits can
+                          be compared
+
+    The filterDesign check also compares FilterDesign.h with
+    juce::dsp::IIR::Coefficients; the exit code is 1 if they disagree.
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+#include "../../Source/PluginEditor.h"
+
+namespace
+{
+    /**
+     every measurement of the run, with the configuration it was taken in.
+     */
+    struct Results
+    {
+        void add(const juce::String& benchmark, const juce::NamedValueSet& configuration, double value, const juce::String& unit)
+        {
+            auto* entry = new juce::DynamicObject();
+            entry->setProperty("benchmark", benchmark);
+            for (auto& property : configuration)
+            {
+                entry->setProperty(property.name, property.value);
+            }
+            entry->setProperty("value", value);
+            entry->setProperty("unit", unit);
+            entries.add(juce::var(entry));
+        }
+
+        juce::String toJSON() const
+        {
+            auto* root = new juce::DynamicObject();
+            root->setProperty("cpu", juce::SystemStats::getCpuModel());
+            root->setProperty("os", juce::SystemStats::getOperatingSystemName());
+            root->setProperty("date", juce::Time::getCurrentTime().toISO8601(true));
+            root->setProperty("results", entries);
+            return juce::JSON::toString(juce::var(root));
+        }
+
+        juce::Array<juce::var> entries;
+    };
+
+    template<typename Function>
+    double measureNanosecondsPerSample(Function&& processOneBlock, int blockSize, int numBlocks)
+    {
+        // warm up caches and branch predictors before timing
+        for (int i = 0; i < 16; ++i)
+        {
+            processOneBlock();
+        }
+
+        auto start = juce::Time::getHighResolutionTicks();
+        for (int i = 0; i < numBlocks; ++i)
+        {
+            processOneBlock();
+        }
+        auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+
+        return seconds * 1.0e9 / (double(blockSize) * double(numBlocks));
+    }
+
+    void fillWithNoise(juce::AudioBuffer<float>& buffer)
+    {
+        juce::Random random(1234);
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+            {
+                buffer.setSample(channel, i, random.nextFloat() * 2.f - 1.f);
+            }
+        }
+    }
+
+    void prepareMonoChain(MonoChain& chain, const juce::dsp::ProcessSpec& spec, const CoefficientSet& coefficientSet)
+    {
+        chain.prepare(spec);
+        updateCoefficients(chain.get<ChainPositions::Peak>().coefficients, coefficientSet.peak);
+        updateCutFilter(chain.get<ChainPositions::LowCut>(), coefficientSet.lowCut, coefficientSet.chainSettings.lowCutSlope);
+        updateCutFilter(chain.get<ChainPositions::HighCut>(), coefficientSet.highCut, coefficientSet.chainSettings.highCutSlope);
+    }
+
+    /**
+     FilterDesign.h against juce::dsp::IIR::Coefficients over a grid of sample
+     rates, frequencies and Qs. Returns false when a coefficient is off by more
+     than a rounding error.
+     */
+    bool checkFilterDesign(Results& results)
+    {
+        using JuceCoefficients = juce::dsp::IIR::Coefficients<double>;
+        const auto tolerance = 1.0e-9;
+        auto worstError = 0.0;
+
+        auto compare = [&worstError](const BiquadCoeffs& designed, const JuceCoefficients::Ptr& reference)
+        {
+            const auto* raw = reference->getRawCoefficients();
+            const double values[] { designed.b0, designed.b1, designed.b2, designed.a1, designed.a2 };
+            for (int i = 0; i < 5; ++i)
+            {
+                worstError = juce::jmax(worstError, std::abs(values[i] - raw[i]) / juce::jmax(1.0, std::abs(raw[i])));
+            }
+        };
+
+        for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+        {
+            for (auto frequency = 20.0; frequency < sampleRate * 0.45; frequency *= 1.37)
+            {
+                for (auto quality : { 0.1, 0.5, 0.7071, 1.0, 3.0, 10.0 })
+                {
+                    compare(makeLowPassBiquad(sampleRate, frequency, quality), JuceCoefficients::makeLowPass(sampleRate, frequency, quality));
+                    compare(makeHighPassBiquad(sampleRate, frequency, quality), JuceCoefficients::makeHighPass(sampleRate, frequency, quality));
+                    for (auto gainInDecibels : { -24.0, -6.0, 6.0, 24.0 })
+                    {
+                        const auto gainFactor = juce::Decibels::decibelsToGain(gainInDecibels);
+                        compare(makePeakBiquad(sampleRate, frequency, quality, gainFactor),
+                                JuceCoefficients::makePeakFilter(sampleRate, frequency, quality, gainFactor));
+                    }
+                }
+            }
+        }
+
+        const auto passed = worstError <= tolerance;
+        std::cout << "FilterDesign against juce::dsp::IIR::Coefficients: worst relative error " << worstError
+                  << (passed ? "" : ", FAILED") << std::endl;
+        results.add("filterDesign.worstError", {}, worstError, "relative");
+        return passed;
+    }
+
+    /**
+     two scalar MonoChains, one per channel, against one FilterEngine that runs both channels in SIMD lanes.
+     */
+    void benchmarkStereoEngine(Results& results, double sampleRate, int blockSize)
+    {
+        ChainSettings chainSettings;
+        chainSettings.lowCutFreq = 80.f;
+        chainSettings.lowCutSlope = Slope_48;
+        chainSettings.peakFreq = 750.f;
+        chainSettings.peakGainInDecibels = 6.f;
+        chainSettings.peakQuality = 1.f;
+        chainSettings.highCutFreq = 12000.f;
+        chainSettings.highCutSlope = Slope_48;
+        auto coefficientSet = makeCoefficientSet(chainSettings, sampleRate);
+
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate;
+        spec.maximumBlockSize = (juce::uint32) blockSize;
+        spec.numChannels = 1;
+
+        MonoChain leftChain, rightChain;
+        prepareMonoChain(leftChain, spec, coefficientSet);
+        prepareMonoChain(rightChain, spec, coefficientSet);
+
+        spec.numChannels = 2;
+        FilterEngine<float> filterEngine;
+        filterEngine.prepare(spec);
+        filterEngine.setCoefficients(coefficientSet);
+        FilterEngine<double> doublePrecisionFilterEngine;
+        doublePrecisionFilterEngine.prepare(spec);
+        doublePrecisionFilterEngine.setCoefficients(coefficientSet);
+
+        juce::AudioBuffer<float> noise(2, blockSize), buffer(2, blockSize);
+        fillWithNoise(noise);
+
+        // ten seconds of audio per measurement
+        const auto numBlocks = juce::jmax(1, int(sampleRate * 10.0 / blockSize));
+
+        auto twoChains = measureNanosecondsPerSample([&]
+        {
+            buffer.makeCopyOf(noise, true);
+            juce::dsp::AudioBlock<float> block(buffer);
+            auto leftBlock = block.getSingleChannelBlock(0);
+            auto rightBlock = block.getSingleChannelBlock(1);
+            juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
+            juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
+            leftChain.process(leftContext);
+            rightChain.process(rightContext);
+        }, blockSize, numBlocks);
+
+        auto engine = measureNanosecondsPerSample([&]
+        {
+            buffer.makeCopyOf(noise, true);
+            juce::dsp::AudioBlock<float> block(buffer);
+            filterEngine.process(block);
+        }, blockSize, numBlocks);
+
+        // float I/O with double filter state, the "High Precision" mode
+        auto doublePrecisionEngine = measureNanosecondsPerSample([&]
+        {
+            buffer.makeCopyOf(noise, true);
+            juce::dsp::AudioBlock<float> block(buffer);
+            doublePrecisionFilterEngine.process(block);
+        }, blockSize, numBlocks);
+
+        std::cout << "stereo cascade @ " << sampleRate << " Hz, block " << blockSize
+                  << ": two MonoChains " << twoChains << " ns/sample, FilterEngine " << engine
+                  << " ns/sample, speedup " << twoChains / engine << "x"
+                  << ", double precision FilterEngine " << doublePrecisionEngine << " ns/sample" << std::endl;
+
+        const juce::NamedValueSet configuration { { "sampleRate", sampleRate }, { "blockSize", blockSize } };
+        results.add("stereoEngine.monoChains", configuration, twoChains, "ns/sample");
+        results.add("stereoEngine.filterEngine", configuration, engine, "ns/sample");
+        results.add("stereoEngine.doublePrecisionFilterEngine", configuration, doublePrecisionEngine, "ns/sample");
+    }
+
+    /**
+     one MonoChain per stream against MultiStreamFilterEngine packing the streams into SIMD lanes.
+     */
+    void benchmarkMultiStream(Results& results, double sampleRate, int blockSize, int numStreams)
+    {
+        juce::Random random(42);
+        std::vector<ChainSettings> settings((size_t) numStreams);
+        for (auto& chainSettings : settings)
+        {
+            chainSettings.lowCutFreq = 20.f + random.nextFloat() * 200.f;
+            chainSettings.lowCutSlope = static_cast<Slope>(random.nextInt(4));
+            chainSettings.peakFreq = 200.f + random.nextFloat() * 5000.f;
+            chainSettings.peakGainInDecibels = random.nextFloat() * 24.f - 12.f;
+            chainSettings.peakQuality = 0.5f + random.nextFloat() * 2.f;
+            chainSettings.highCutFreq = 5000.f + random.nextFloat() * 15000.f;
+            chainSettings.highCutSlope = static_cast<Slope>(random.nextInt(4));
+        }
+
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate;
+        spec.maximumBlockSize = (juce::uint32) blockSize;
+        spec.numChannels = 1;
+
+        std::vector<MonoChain> monoChains((size_t) numStreams);
+        for (size_t i = 0; i < monoChains.size(); ++i)
+        {
+            prepareMonoChain(monoChains[i], spec, makeCoefficientSet(settings[i], sampleRate));
+        }
+
+        MultiStreamFilterEngine<float> multiStreamEngine;
+        multiStreamEngine.prepare(sampleRate, blockSize, numStreams);
+
+        juce::AudioBuffer<float> noise(numStreams, blockSize), buffer(numStreams, blockSize);
+        fillWithNoise(noise);
+
+        const auto numBlocks = juce::jmax(1, int(sampleRate / blockSize));
+
+        auto monoChainsTime = measureNanosecondsPerSample([&]
+        {
+            buffer.makeCopyOf(noise, true);
+            juce::dsp::AudioBlock<float> block(buffer);
+            for (size_t i = 0; i < monoChains.size(); ++i)
+            {
+                auto streamBlock = block.getSingleChannelBlock(i);
+                juce::dsp::ProcessContextReplacing<float> context(streamBlock);
+                monoChains[i].process(context);
+            }
+        }, blockSize * numStreams, numBlocks);
+
+        auto engineTime = measureNanosecondsPerSample([&]
+        {
+            buffer.makeCopyOf(noise, true);
+            multiStreamEngine.processStreams(buffer.getArrayOfWritePointers(), settings.data(),
+                                             settings.size(), (size_t) blockSize);
+        }, blockSize * numStreams, numBlocks);
+
+        std::cout << numStreams << " independent streams @ " << sampleRate << " Hz, block " << blockSize
+                  << ": MonoChains " << monoChainsTime << " ns/sample, MultiStreamFilterEngine " << engineTime
+                  << " ns/sample, speedup " << monoChainsTime / engineTime << "x" << std::endl;
+
+        const juce::NamedValueSet configuration { { "sampleRate", sampleRate }, { "blockSize", blockSize }, { "numStreams", numStreams } };
+        results.add("multiStream.monoChains", configuration, monoChainsTime, "ns/sample");
+        results.add("multiStream.multiStreamFilterEngine", configuration, engineTime, "ns/sample");
+    }
+
+    /**
+     cost of the stereo cascade wrapped in each oversampling factor, per host-rate sample.
+     */
+    void benchmarkOversampling(Results& results, double sampleRate, int blockSize)
+    {
+        ChainSettings chainSettings;
+        chainSettings.lowCutFreq = 80.f;
+        chainSettings.lowCutSlope = Slope_24;
+        chainSettings.peakFreq = 8000.f;
+        chainSettings.peakGainInDecibels = 6.f;
+        chainSettings.peakQuality = 1.f;
+        chainSettings.highCutFreq = 18000.f;
+        chainSettings.highCutSlope = Slope_24;
+
+        juce::AudioBuffer<float> noise(2, blockSize), buffer(2, blockSize);
+        fillWithNoise(noise);
+        const auto numBlocks = juce::jmax(1, int(sampleRate * 10.0 / blockSize));
+
+        for (int order = 0; order < 4; ++order)
+        {
+            chainSettings.oversamplingOrder = order;
+
+            juce::dsp::Oversampling<float> oversampler(2, (size_t) order, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, true);
+            oversampler.initProcessing((size_t) blockSize);
+
+            juce::dsp::ProcessSpec spec;
+            spec.sampleRate = getDesignSampleRate(chainSettings, sampleRate);
+            spec.maximumBlockSize = (juce::uint32) (blockSize << order);
+            spec.numChannels = 2;
+
+            FilterEngine<float> filterEngine;
+            filterEngine.prepare(spec);
+            filterEngine.setCoefficients(makeCoefficientSet(chainSettings, spec.sampleRate));
+
+            auto time = measureNanosecondsPerSample([&]
+            {
+                buffer.makeCopyOf(noise, true);
+                juce::dsp::AudioBlock<float> block(buffer);
+                if (order == 0)
+                {
+                    filterEngine.process(block);
+                    return;
+                }
+
+                auto oversampledBlock = oversampler.processSamplesUp(block);
+                filterEngine.process(oversampledBlock);
+                oversampler.processSamplesDown(block);
+            }, blockSize, numBlocks);
+
+            std::cout << "oversampling " << (1 << order) << "x @ " << sampleRate << " Hz, block " << blockSize
+                      << ": " << time << " ns/sample, latency "
+                      << (order == 0 ? 0.f : oversampler.getLatencyInSamples()) << " samples" << std::endl;
+            results.add("oversampling", { { "sampleRate", sampleRate }, { "blockSize", blockSize }, { "factor", 1 << order } }, time, "ns/sample");
+        }
+    }
+
+    /**
+     the linear phase FIR for each partition size, per host-rate sample.
+     */
+    void benchmarkLinearPhase(Results& results, double sampleRate, int blockSize)
+    {
+        ChainSettings chainSettings;
+        chainSettings.lowCutFreq = 80.f;
+        chainSettings.lowCutSlope = Slope_48;
+        chainSettings.peakFreq = 750.f;
+        chainSettings.peakGainInDecibels = 6.f;
+        chainSettings.peakQuality = 1.f;
+        chainSettings.highCutFreq = 12000.f;
+        chainSettings.highCutSlope = Slope_48;
+        auto coefficientSet = makeCoefficientSet(chainSettings, sampleRate);
+
+        juce::AudioBuffer<float> noise(2, blockSize), buffer(2, blockSize);
+        fillWithNoise(noise);
+        const auto numBlocks = juce::jmax(1, int(sampleRate * 10.0 / blockSize));
+
+        for (int index = 0; index < LinearPhaseEngine::numPartitionSizes; ++index)
+        {
+            LinearPhaseEngine linearPhaseEngine;
+            linearPhaseEngine.prepare(sampleRate, 2);
+            linearPhaseEngine.buildKernel(coefficientSet, index);
+
+            auto time = measureNanosecondsPerSample([&]
+            {
+                buffer.makeCopyOf(noise, true);
+                juce::dsp::AudioBlock<float> block(buffer);
+                linearPhaseEngine.process(block);
+            }, blockSize, numBlocks);
+
+            std::cout << "linear phase, partition " << LinearPhaseEngine::getPartitionSize(index)
+                      << " @ " << sampleRate << " Hz, block " << blockSize << ": " << time
+                      << " ns/sample, latency " << linearPhaseEngine.getLatencyInSamples() << " samples" << std::endl;
+            results.add("linearPhase", { { "sampleRate", sampleRate }, { "blockSize", blockSize },
+                                         { "partitionSize", LinearPhaseEngine::getPartitionSize(index) } }, time, "ns/sample");
+        }
+    }
+
+    //==============================================================================
+    void setParameter(SimpleEQAudioProcessor& processor, const juce::String& parameterID, float value)
+    {
+        auto* parameter = processor.apvts.getParameter(parameterID);
+        parameter->setValueNotifyingHost(parameter->convertTo0to1(value));
+    }
+
+    /**
+     the whole processBlock, as a host calls it, over block sizes, sample rates
+     and every combination of low and high cut slope.
+     */
+    void benchmarkProcessBlock(Results& results)
+    {
+        SimpleEQAudioProcessor processor;
+        setParameter(processor, "LowCut Freq", 80.f);
+        setParameter(processor, "HighCut Freq", 12000.f);
+        setParameter(processor, "Peak Freq", 750.f);
+        setParameter(processor, "Peak Gain", 6.f);
+        setParameter(processor, "Peak Quality", 1.f);
+
+        juce::MidiBuffer midi;
+
+        for (auto sampleRate : { 44100.0, 48000.0, 96000.0, 192000.0 })
+        {
+            for (auto blockSize : { 16, 64, 256, 1024, 4096 })
+            {
+                juce::AudioBuffer<float> noise(2, blockSize), buffer(2, blockSize);
+                fillWithNoise(noise);
+
+                // one second of audio per measurement
+                const auto numBlocks = juce::jmax(1, int(sampleRate / blockSize));
+
+                for (int lowCutSlope = Slope_12; lowCutSlope <= Slope_48; ++lowCutSlope)
+                {
+                    for (int highCutSlope = Slope_12; highCutSlope <= Slope_48; ++highCutSlope)
+                    {
+                        setParameter(processor, "LowCut Slope", (float) lowCutSlope);
+                        setParameter(processor, "HighCut Slope", (float) highCutSlope);
+
+                        // designs the coefficients for the new slopes before returning
+                        processor.setPlayConfigDetails(2, 2, sampleRate, blockSize);
+                        processor.prepareToPlay(sampleRate, blockSize);
+
+                        auto time = measureNanosecondsPerSample([&]
+                        {
+                            buffer.makeCopyOf(noise, true);
+                            processor.processBlock(buffer, midi);
+                        }, blockSize, numBlocks);
+
+                        processor.releaseResources();
+
+                        std::cout << "processBlock @ " << sampleRate << " Hz, block " << blockSize
+                                  << ", slopes " << getNumSections(static_cast<Slope>(lowCutSlope)) * 12
+                                  << "/" << getNumSections(static_cast<Slope>(highCutSlope)) * 12
+                                  << " dB/Oct: " << time << " ns/sample" << std::endl;
+                        results.add("processBlock", { { "sampleRate", sampleRate }, { "blockSize", blockSize },
+                                                      { "lowCutSlope", lowCutSlope }, { "highCutSlope", highCutSlope } },
+                                    time, "ns/sample");
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     what a parameter change costs: designing a CoefficientSet, with and without
+     the shared cache, and applying it to both engines like updateFilters() does.
+     */
+    void benchmarkCoefficientUpdate(Results& results, double sampleRate)
+    {
+        // a sweep of different settings so nothing gets folded away
+        std::vector<ChainSettings> settings(256);
+        for (size_t i = 0; i < settings.size(); ++i)
+        {
+            settings[i].lowCutFreq = 20.f + (float) i;
+            settings[i].lowCutSlope = static_cast<Slope>(i % 4);
+            settings[i].peakFreq = 500.f + 10.f * (float) i;
+            settings[i].peakGainInDecibels = 6.f;
+            settings[i].peakQuality = 1.f;
+            settings[i].highCutFreq = 15000.f - 10.f * (float) i;
+            settings[i].highCutSlope = static_cast<Slope>((i / 4) % 4);
+        }
+
+        juce::dsp::ProcessSpec spec;
+        spec.sampleRate = sampleRate;
+        spec.maximumBlockSize = 512;
+        spec.numChannels = 2;
+        FilterEngine<float> filterEngine;
+        filterEngine.prepare(spec);
+        FilterEngine<double> doublePrecisionFilterEngine;
+        doublePrecisionFilterEngine.prepare(spec);
+
+        CoefficientCache cache;
+        std::vector<CoefficientSet> designed(settings.size());
+        const auto numCalls = 100000;
+        size_t index = 0;
+
+        auto design = measureNanosecondsPerSample([&]
+        {
+            index = (index + 1) % settings.size();
+            designed[index] = makeCoefficientSet(settings[index], sampleRate);
+        }, 1, numCalls);
+
+        // fill the cache first, so every lookup is a hit
+        for (auto& chainSettings : settings)
+        {
+            makeCoefficientSet(chainSettings, sampleRate, cache);
+        }
+
+        auto cachedDesign = measureNanosecondsPerSample([&]
+        {
+            index = (index + 1) % settings.size();
+            designed[index] = makeCoefficientSet(settings[index], sampleRate, cache);
+        }, 1, numCalls);
+
+        auto apply = measureNanosecondsPerSample([&]
+        {
+            index = (index + 1) % settings.size();
+            filterEngine.setCoefficients(designed[index]);
+            doublePrecisionFilterEngine.setCoefficients(designed[index]);
+        }, 1, numCalls);
+
+        std::cout << "coefficient update @ " << sampleRate << " Hz: design " << design << " ns, cached design "
+                  << cachedDesign << " ns, apply to the engines " << apply << " ns" << std::endl;
+
+        const juce::NamedValueSet configuration { { "sampleRate", sampleRate } };
+        results.add("updateFilters.design", configuration, design, "ns/call");
+        results.add("updateFilters.cachedDesign", configuration, cachedDesign, "ns/call");
+        results.add("updateFilters.apply", configuration, apply, "ns/call");
+    }
+
+    /**
+     one analyzer frame at each FFTOrder: the FFT data for a packed stereo
+     pair, and the path drawn from one of its spectra.
+     */
+    void benchmarkAnalyzer(Results& results, const juce::String& filter)
+    {
+        const auto sampleRate = 48000.0;
+        const auto negativeInfinity = -48.f;
+        const auto numCalls = 2000;
+
+        for (auto order : { FFTOrder::order2048, FFTOrder::order4096, FFTOrder::order8192 })
+        {
+            StereoFFTDataGenerator stereoFFTDataGenerator;
+            stereoFFTDataGenerator.changeOrder(order);
+            const auto fftSize = stereoFFTDataGenerator.getFFTSize();
+
+            juce::AudioBuffer<float> left(1, fftSize), right(1, fftSize);
+            fillWithNoise(left);
+            fillWithNoise(right);
+
+            if (juce::String("stereoFFTDataGenerator").contains(filter))
+            {
+                auto time = measureNanosecondsPerSample([&]
+                {
+                    stereoFFTDataGenerator.produceFFTDataForRendering(left, right, negativeInfinity, false);
+                }, 1, numCalls);
+
+                std::cout << "StereoFFTDataGenerator, fft size " << fftSize << ": " << time / 1000.0 << " us/stereo frame" << std::endl;
+                results.add("stereoFFTDataGenerator", { { "fftSize", fftSize } }, time, "ns/call");
+            }
+
+            if (juce::String("analyzerPathGenerator").contains(filter))
+            {
+                stereoFFTDataGenerator.produceFFTDataForRendering(left, right, negativeInfinity, false);
+                const auto& fftData = stereoFFTDataGenerator.getFFTData(StereoFFTDataGenerator::Left);
+
+                AnalyzerPathGenerator<juce::Path> pathGenerator;
+                juce::Path path;
+                const juce::Rectangle<float> bounds(0.f, 0.f, 600.f, 250.f);
+                const auto binWidth = float(sampleRate / fftSize);
+
+                auto time = measureNanosecondsPerSample([&]
+                {
+                    pathGenerator.generatePath(fftData, bounds, fftSize, binWidth, negativeInfinity, path);
+                }, 1, numCalls);
+
+                std::cout << "AnalyzerPathGenerator, fft size " << fftSize << ": " << time / 1000.0 << " us/path" << std::endl;
+                results.add("analyzerPathGenerator", { { "fftSize", fftSize } }, time, "ns/call");
+            }
+        }
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // the processor posts async updates and needs a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+    juce::ScopedNoDenormals noDenormals;
+
+    juce::String filter;
+    juce::File jsonFile;
+    for (int i = 1; i + 1 < argc; i += 2)
+    {
+        const juce::String option(argv[i]), value(argv[i + 1]);
+        if (option == "--filter")
+            filter = value;
+        else if (option == "--json")
+            jsonFile = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+    }
+
+    auto shouldRun = [&filter](const juce::String& name) { return name.contains(filter); };
+    Results results;
+    bool checksPassed = true;
+
+    if (shouldRun("filterDesign"))
+        checksPassed = checkFilterDesign(results);
+
+    if (shouldRun("stereoEngine"))
+    {
+        for (auto blockSize : { 32, 512 })
+        {
+            benchmarkStereoEngine(results, 48000.0, blockSize);
+        }
+    }
+
+    if (shouldRun("multiStream"))
+        benchmarkMultiStream(results, 48000.0, 512, 256);
+    if (shouldRun("oversampling"))
+        benchmarkOversampling(results, 48000.0, 512);
+    if (shouldRun("linearPhase"))
+        benchmarkLinearPhase(results, 48000.0, 512);
+    if (shouldRun("processBlock"))
+        benchmarkProcessBlock(results);
+    if (shouldRun("updateFilters"))
+        benchmarkCoefficientUpdate(results, 48000.0);
+    if (shouldRun("stereoFFTDataGenerator") || shouldRun("analyzerPathGenerator"))
+        benchmarkAnalyzer(results, filter);
+
+    if (jsonFile != juce::File() && !jsonFile.replaceWithText(results.toJSON()))
+    {
+        std::cerr << "can't write " << jsonFile.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    return checksPassed ? 0 : 1;
+}
@@ -0,0 +1,367 @@
+/*
+  ==============================================================================
+
+    Headless batch renderer: runs audio files through SimpleEQAudioProcessor
+    without a host or an editor.
+
+        SimpleEQRenderer [options] <input files...>
+
+        --state <file>       plugin state as saved by getStateInformation()
+        --settings <file>    one "Parameter ID = value" per line, in the
+                             parameter's own units, e.g. "Peak Freq = 1200"
+        --output-dir <dir>   where the results go, next to the inputs by default
+        --suffix <text>      appended to the output file names, "_eq" by default
+        --jobs <n>           number of files rendered in parallel
+        --block-size <n>     samples per processBlock call
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "../../Source/PluginProcessor.h"
+
+namespace
+{
+    struct Options
+    {
+        juce::File stateFile, settingsFile, outputDirectory;
+        juce::String suffix { "_eq" };
+        int numJobs = juce::SystemStats::getNumCpus();
+        int blockSize = 16384;
+        juce::Array<juce::File> inputFiles;
+    };
+
+    bool parseOptions(const juce::StringArray& args, Options& options, juce::String& error)
+    {
+        for (int i = 0; i < args.size(); ++i)
+        {
+            const auto& arg = args[i];
+            if (!arg.startsWith("--"))
+            {
+                options.inputFiles.add(juce::File::getCurrentWorkingDirectory().getChildFile(arg));
+                continue;
+            }
+
+            if (i + 1 >= args.size())
+            {
+                error = "missing value for " + arg;
+                return false;
+            }
+
+            const auto value = args[++i];
+            const auto file = juce::File::getCurrentWorkingDirectory().getChildFile(value);
+
+            if (arg == "--state")
+                options.stateFile = file;
+            else if (arg == "--settings")
+                options.settingsFile = file;
+            else if (arg == "--output-dir")
+                options.outputDirectory = file;
+            else if (arg == "--suffix")
+                options.suffix = value;
+            else if (arg == "--jobs")
+                options.numJobs = juce::jmax(1, value.getIntValue());
+            else if (arg == "--block-size")
+                options.blockSize = juce::jmax(32, value.getIntValue());
+            else
+            {
+                error = "unknown option " + arg;
+                return false;
+            }
+        }
+
+        if (options.inputFiles.isEmpty())
+        {
+            error = "no input files";
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     applies "Parameter ID = value" lines, values in the parameter's own range.
+     */
+    bool applySettingsFile(SimpleEQAudioProcessor& processor, const juce::File& file, juce::String& error)
+    {
+        juce::StringArray lines;
+        file.readLines(lines);
+
+        for (auto line : lines)
+        {
+            line = line.upToFirstOccurrenceOf("#", false, false).trim();
+            if (line.isEmpty())
+                continue;
+
+            const auto parameterID = line.upToFirstOccurrenceOf("=", false, false).trim();
+            const auto value = line.fromFirstOccurrenceOf("=", false, false).trim();
+            auto* parameter = processor.apvts.getParameter(parameterID);
+            if (parameter == nullptr || value.isEmpty())
+            {
+                error = file.getFileName() + ": can't apply \"" + line + "\"";
+                return false;
+            }
+
+            // choices and toggles may be given by name, e.g. "LowCut Slope = 24 db/Oct"
+            auto normalised = parameter->getValueForText(value);
+            if (auto* ranged = dynamic_cast<juce::RangedAudioParameter*>(parameter);
+                ranged != nullptr && value.containsOnly("0123456789.-+eE"))
+            {
+                normalised = ranged->convertTo0to1(value.getFloatValue());
+            }
+            parameter->setValueNotifyingHost(normalised);
+        }
+        return true;
+    }
+
+    bool loadState(SimpleEQAudioProcessor& processor, const Options& options, juce::String& error)
+    {
+        if (options.stateFile != juce::File())
+        {
+            juce::MemoryBlock state;
+            if (!options.stateFile.loadFileAsData(state))
+            {
+                error = "can't read " + options.stateFile.getFullPathName();
+                return false;
+            }
+            processor.setStateInformation(state.getData(), (int) state.getSize());
+        }
+
+        // settings on top of the state, so a preset can be tweaked per run
+        if (options.settingsFile != juce::File())
+            return applySettingsFile(processor, options.settingsFile, error);
+
+        return true;
+    }
+
+    //==============================================================================
+    /**
+     streams one file through the processor, block by block, so memory stays
+     flat no matter how long the file is. The output is shifted back by the
+     reported latency and has the same length as the input.
+     */
+    class FileRenderer
+    {
+    public:
+        FileRenderer(SimpleEQAudioProcessor& p, juce::AudioFormatManager& formats, const Options& o) :
+            processor(p), formatManager(formats), options(o)
+        {
+        }
+
+        /** renders one file, 'message' gets the realtime factor or what went wrong. */
+        bool render(const juce::File& inputFile, juce::String& message)
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(inputFile));
+            if (reader == nullptr)
+            {
+                message = "can't read " + inputFile.getFullPathName();
+                return false;
+            }
+
+            const auto numChannels = (int) reader->numChannels;
+            const auto sampleRate = reader->sampleRate;
+            const auto length = reader->lengthInSamples;
+
+            juce::AudioProcessor::BusesLayout layout;
+            const auto channelSet = numChannels <= 2 ? juce::AudioChannelSet::canonicalChannelSet(numChannels)
+                                                     : juce::AudioChannelSet::discreteChannels(numChannels);
+            layout.inputBuses.add(channelSet);
+            layout.outputBuses.add(channelSet);
+            if (!processor.setBusesLayout(layout))
+            {
+                message = "unsupported channel count in " + inputFile.getFileName();
+                return false;
+            }
+
+            auto outputDirectory = options.outputDirectory != juce::File() ? options.outputDirectory
+                                                                           : inputFile.getParentDirectory();
+            auto outputFile = outputDirectory.getChildFile(inputFile.getFileNameWithoutExtension()
+                                                           + options.suffix + inputFile.getFileExtension());
+            // an empty suffix into the input's own folder, or a link to it, would
+            // replace the input with its own rendering
+            if (outputFile.getLinkedTarget() == inputFile.getLinkedTarget())
+            {
+                message = "refusing to overwrite " + inputFile.getFullPathName() + ", set --suffix or --output-dir";
+                return false;
+            }
+
+            // rendered next to the output and moved over it only once complete,
+            // so a failed render leaves an existing output alone
+            juce::TemporaryFile temporaryFile(outputFile);
+            std::unique_ptr<juce::FileOutputStream> stream(temporaryFile.getFile().createOutputStream());
+            auto* format = formatManager.findFormatForFileExtension(inputFile.getFileExtension());
+            if (stream == nullptr || format == nullptr)
+            {
+                message = "can't write " + outputFile.getFullPathName();
+                return false;
+            }
+
+            std::unique_ptr<juce::AudioFormatWriter> writer(format->createWriterFor(stream.get(), sampleRate,
+                                                                                    (unsigned int) numChannels,
+                                                                                    (int) reader->bitsPerSample,
+                                                                                    reader->metadataValues, 0));
+            if (writer == nullptr)
+            {
+                message = "can't write " + outputFile.getFullPathName();
+                return false;
+            }
+            stream.release();
+
+            const auto start = juce::Time::getHighResolutionTicks();
+
+            processor.setNonRealtime(true);
+            processor.prepareToPlay(sampleRate, options.blockSize);
+            const auto latency = (juce::int64) processor.getLatencySamples();
+
+            juce::AudioBuffer<float> buffer(numChannels, options.blockSize);
+            juce::MidiBuffer midi;
+
+            // keep feeding silence after the end until the delayed output has caught up
+            juce::int64 inputPosition = 0, written = 0;
+            while (written < length)
+            {
+                const auto numToRead = (int) juce::jlimit((juce::int64) 0, (juce::int64) options.blockSize, length - inputPosition);
+                buffer.clear();
+                if (numToRead > 0)
+                    reader->read(&buffer, 0, numToRead, inputPosition, true, true);
+
+                processor.processBlock(buffer, midi);
+
+                // the block holds output samples [inputPosition - latency, + blockSize)
+                const auto blockStart = inputPosition - latency;
+                const auto skip = juce::jmax((juce::int64) 0, -blockStart);
+                const auto numToWrite = juce::jmin((juce::int64) options.blockSize - skip, length - written);
+                if (numToWrite > 0 && !writer->writeFromAudioSampleBuffer(buffer, (int) skip, (int) numToWrite))
+                {
+                    processor.releaseResources();
+                    message = "can't write " + outputFile.getFullPathName();
+                    return false;
+                }
+
+                written += juce::jmax((juce::int64) 0, numToWrite);
+                inputPosition += options.blockSize;
+            }
+
+            processor.releaseResources();
+
+            // flushes and closes the temporary file before it's moved
+            writer.reset();
+            if (!temporaryFile.overwriteTargetFileWithTemporary())
+            {
+                message = "can't replace " + outputFile.getFullPathName();
+                return false;
+            }
+
+            const auto seconds = juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start);
+            const auto audioSeconds = (double) length / sampleRate;
+
+            message.clear();
+            message << inputFile.getFileName() << " -> " << outputFile.getFileName() << ": "
+                   << juce::String(audioSeconds, 1) << " s of audio in " << juce::String(seconds, 2)
+                   << " s, realtime factor " << juce::String(audioSeconds / juce::jmax(seconds, 1.0e-9), 1) << "x";
+            return true;
+        }
+    private:
+        SimpleEQAudioProcessor& processor;
+        juce::AudioFormatManager& formatManager;
+        const Options& options;
+    };
+
+    //==============================================================================
+    /**
+     one worker per job, each with its own processor instance, pulling the
+     next file off a shared index until all are done.
+     */
+    class RenderWorker : public juce::Thread
+    {
+    public:
+        RenderWorker(const Options& o, std::atomic<int>& next, juce::CriticalSection& outputLock, std::atomic<int>& failures) :
+            juce::Thread("SimpleEQ Render Worker"),
+            options(o), nextFile(next), consoleLock(outputLock), numFailures(failures)
+        {
+            formatManager.registerBasicFormats();
+        }
+
+        ~RenderWorker() override { stopThread(-1); }
+
+        juce::String prepare()
+        {
+            // no editor registers with the analyzer tap, so it stays off
+            juce::String error;
+            loadState(processor, options, error);
+            return error;
+        }
+
+        void run() override
+        {
+            FileRenderer renderer(processor, formatManager, options);
+
+            for (auto index = nextFile++; index < options.inputFiles.size() && !threadShouldExit(); index = nextFile++)
+            {
+                juce::String message;
+                if (!renderer.render(options.inputFiles[index], message))
+                    ++numFailures;
+
+                const juce::ScopedLock sl(consoleLock);
+                std::cout << message << std::endl;
+            }
+        }
+    private:
+        const Options& options;
+        std::atomic<int>& nextFile;
+        juce::CriticalSection& consoleLock;
+        std::atomic<int>& numFailures;
+        juce::AudioFormatManager formatManager;
+        SimpleEQAudioProcessor processor;
+    };
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    // processors post async updates and need a message manager to exist
+    juce::ScopedJuceInitialiser_GUI juceInitialiser;
+
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::CharPointer_UTF8(argv[i]));
+
+    Options options;
+    juce::String error;
+    if (!parseOptions(args, options, error))
+    {
+        std::cerr << error << std::endl
+                  << "usage: SimpleEQRenderer [--state file] [--settings file] [--output-dir dir] [--suffix text]"
+                  << " [--jobs n] [--block-size n] <input files...>" << std::endl;
+        return 1;
+    }
+
+    if (options.outputDirectory != juce::File())
+        options.outputDirectory.createDirectory();
+
+    std::atomic<int> nextFile { 0 }, numFailures { 0 };
+    juce::CriticalSection consoleLock;
+    juce::OwnedArray<RenderWorker> workers;
+
+    const auto start = juce::Time::getHighResolutionTicks();
+    for (int i = 0; i < juce::jmin(options.numJobs, options.inputFiles.size()); ++i)
+    {
+        auto* worker = workers.add(new RenderWorker(options, nextFile, consoleLock, numFailures));
+        error = worker->prepare();
+        if (error.isNotEmpty())
+        {
+            std::cerr << error << std::endl;
+            return 1;
+        }
+    }
+
+    for (auto* worker : workers)
+        worker->startThread();
+    for (auto* worker : workers)
+        worker->waitForThreadToExit(-1);
+
+    std::cout << options.inputFiles.size() << " files with " << workers.size() << " jobs in "
+              << juce::Time::highResolutionTicksToSeconds(juce::Time::getHighResolutionTicks() - start)
+              << " s" << std::endl;
+
+    return numFailures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+/*
+  ==============================================================================
+
+    FilterDesign.h
+
+    Allocation-free filter design. Every function writes plain biquad sections
+    into caller-owned storage and is constexpr, so a coefficient refresh costs
+    only arithmetic and fixed settings can be designed at compile time:
+
+        constexpr auto lowCut = []
+        {
+            ChainSettings settings;
+            settings.lowCutFreq = 80.f;
+            settings.lowCutSlope = Slope_24;
+
+            CutCoefficients sections {};
+            makeLowCutFilter(settings, 48000.0, sections);
+            return sections;
+        }();
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+
+enum Slope
+{
+    Slope_12,
+    Slope_24,
+    Slope_36,
+    Slope_48
+};
+
+struct ChainSettings
+{
+    float peakFreq{0};
+    float peakGainInDecibels{0};
+    float peakQuality{1.f};
+    float lowCutFreq{0};
+    float highCutFreq{0};
+    Slope lowCutSlope{Slope::Slope_12};
+    Slope highCutSlope{Slope::Slope_12};
+    int oversamplingOrder{0};
+};
+
+constexpr bool operator==(const ChainSettings &a, const ChainSettings &b)
+{
+    return a.peakFreq == b.peakFreq
+        && a.peakGainInDecibels == b.peakGainInDecibels
+        && a.peakQuality == b.peakQuality
+        && a.lowCutFreq == b.lowCutFreq
+        && a.highCutFreq == b.highCutFreq
+        && a.lowCutSlope == b.lowCutSlope
+        && a.highCutSlope == b.highCutSlope
+        && a.oversamplingOrder == b.oversamplingOrder;
+}
+
+constexpr bool operator!=(const ChainSettings &a, const ChainSettings &b) { return !(a == b); }
+
+/**
+ one second order section, normalised so that a0 == 1.
+ */
+struct BiquadCoeffs
+{
+    double b0{1}, b1{0}, b2{0}, a1{0}, a2{0};
+};
+
+static constexpr int maxCutSections = 4;
+using CutCoefficients = std::array<BiquadCoeffs, maxCutSections>;
+
+struct CoefficientSet
+{
+    ChainSettings chainSettings;
+    BiquadCoeffs peak;
+    CutCoefficients lowCut, highCut;
+};
+
+//==============================================================================
+namespace FilterMath
+{
+    constexpr double pi = 3.141592653589793238462643383279502884;
+    constexpr double ln10 = 2.302585092994045684017991454684364208;
+
+    constexpr double sin(double x)
+    {
+        // bring x into [-pi, pi] and sum the taylor series
+        const auto turns = static_cast<long long>(x / (2 * pi) + (x < 0 ? -0.5 : 0.5));
+        x -= static_cast<double>(turns) * 2 * pi;
+
+        double term = x, sum = x;
+        for (int n = 1; n < 30; ++n)
+        {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double cos(double x) { return sin(x + pi / 2); }
+    constexpr double tan(double x) { return sin(x) / cos(x); }
+
+    constexpr double sqrt(double x)
+    {
+        if (x <= 0)
+            return 0;
+
+        double guess = x > 1 ? x : 1;
+        for (int i = 0; i < 100; ++i)
+        {
+            const auto next = 0.5 * (guess + x / guess);
+            if (next == guess)
+                break;
+            guess = next;
+        }
+        return guess;
+    }
+
+    constexpr double exp(double x)
+    {
+        // e^x = e^n * e^r with n the nearest integer, the series only sees |r| <= 0.5
+        const auto n = static_cast<long long>(x + (x < 0 ? -0.5 : 0.5));
+        const auto r = x - static_cast<double>(n);
+
+        double term = 1, sum = 1;
+        for (int k = 1; k < 25; ++k)
+        {
+            term *= r / k;
+            sum += term;
+        }
+
+        constexpr double e = 2.718281828459045235360287471352662498;
+        for (auto i = n; i > 0; --i)
+            sum *= e;
+        for (auto i = n; i < 0; ++i)
+            sum /= e;
+        return sum;
+    }
+
+    constexpr double decibelsToGain(double decibels, double minusInfinityDb = -100.0)
+    {
+        return decibels > minusInfinityDb ? exp(decibels * ln10 / 20.0) : 0.0;
+    }
+}
+
+//==============================================================================
+constexpr BiquadCoeffs makeBiquad(double b0, double b1, double b2, double a0, double a1, double a2)
+{
+    return { b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+}
+
+constexpr BiquadCoeffs makeLowPassBiquad(double sampleRate, double frequency, double Q)
+{
+    const auto n = 1.0 / FilterMath::tan(FilterMath::pi * frequency / sampleRate);
+    const auto nSquared = n * n;
+    const auto invQ = 1.0 / Q;
+    const auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+    return { c1, c1 * 2.0, c1, c1 * 2.0 * (1.0 - nSquared), c1 * (1.0 - invQ * n + nSquared) };
+}
+
+constexpr BiquadCoeffs makeHighPassBiquad(double sampleRate, double frequency, double Q)
+{
+    const auto n = FilterMath::tan(FilterMath::pi * frequency / sampleRate);
+    const auto nSquared = n * n;
+    const auto invQ = 1.0 / Q;
+    const auto c1 = 1.0 / (1.0 + invQ * n + nSquared);
+
+    return { c1, c1 * -2.0, c1, c1 * 2.0 * (nSquared - 1.0), c1 * (1.0 - invQ * n + nSquared) };
+}
+
+constexpr BiquadCoeffs makePeakBiquad(double sampleRate, double frequency, double Q, double gainFactor)
+{
+    const auto A = FilterMath::sqrt(gainFactor);
+    const auto omega = (2.0 * FilterMath::pi * (frequency > 2.0 ? frequency : 2.0)) / sampleRate;
+    const auto alpha = FilterMath::sin(omega) / (Q * 2.0);
+    const auto c2 = -2.0 * FilterMath::cos(omega);
+    const auto alphaTimesA = alpha * A;
+    const auto alphaOverA = alpha / A;
+
+    return makeBiquad(1.0 + alphaTimesA, c2, 1.0 - alphaTimesA, 1.0 + alphaOverA, c2, 1.0 - alphaOverA);
+}
+
+/**
+ Q of section 'index' of an even order Butterworth cascade.
+ */
+constexpr double butterworthQ(int index, int order)
+{
+    return 1.0 / (2.0 * FilterMath::cos((2.0 * (index + 1) - 1.0) * FilterMath::pi / (order * 2.0)));
+}
+
+constexpr int getNumSections(Slope slope) { return static_cast<int>(slope) + 1; }
+
+/** the filters run, and so are designed, at the oversampled rate. */
+constexpr double getDesignSampleRate(const ChainSettings &chainSettings, double sampleRate)
+{
+    return sampleRate * (1 << chainSettings.oversamplingOrder);
+}
+
+/** a peak at 0 dB is an exact identity, so it can be left out of the chain. */
+constexpr bool isPeakActive(const ChainSettings &chainSettings) { return chainSettings.peakGainInDecibels != 0.f; }
+
+//==============================================================================
+constexpr BiquadCoeffs makePeakFilter(const ChainSettings &chainSettings, double sampleRate)
+{
+    return makePeakBiquad(sampleRate,
+                          chainSettings.peakFreq,
+                          chainSettings.peakQuality,
+                          FilterMath::decibelsToGain(chainSettings.peakGainInDecibels));
+}
+
+/**
+ writes the active sections of the low cut into 'sections', the rest are left untouched.
+ */
+constexpr void makeLowCutFilter(const ChainSettings &chainSettings, double sampleRate, CutCoefficients &sections)
+{
+    const auto numSections = getNumSections(chainSettings.lowCutSlope);
+    for (int i = 0; i < numSections; ++i)
+        sections[i] = makeHighPassBiquad(sampleRate, chainSettings.lowCutFreq, butterworthQ(i, numSections * 2));
+}
+
+constexpr void makeHighCutFilter(const ChainSettings &chainSettings, double sampleRate, CutCoefficients &sections)
+{
+    const auto numSections = getNumSections(chainSettings.highCutSlope);
+    for (int i = 0; i < numSections; ++i)
+        sections[i] = makeLowPassBiquad(sampleRate, chainSettings.highCutFreq, butterworthQ(i, numSections * 2));
+}
+
+//==============================================================================
+/**
+ |H|^2 of one section in closed form, from cos(w) and cos(2w) of the normalised
+ angular frequency w.
+ */
+constexpr double getMagnitudeSquared(const BiquadCoeffs &c, double cosW, double cos2W)
+{
+    const auto numerator = c.b0 * c.b0 + c.b1 * c.b1 + c.b2 * c.b2
+                         + 2.0 * (c.b0 * c.b1 + c.b1 * c.b2) * cosW
+                         + 2.0 * c.b0 * c.b2 * cos2W;
+    const auto denominator = 1.0 + c.a1 * c.a1 + c.a2 * c.a2
+                           + 2.0 * (c.a1 + c.a1 * c.a2) * cosW
+                           + 2.0 * c.a2 * cos2W;
+    return numerator / denominator;
+}
+
+/**
+ magnitude of the whole chain, only counting the sections that are active for its settings.
+ */
+constexpr double getMagnitudeForFrequency(const CoefficientSet &coefficientSet, double frequency, double sampleRate)
+{
+    const auto w = 2.0 * FilterMath::pi * frequency / sampleRate;
+    const auto cosW = FilterMath::cos(w);
+    const auto cos2W = FilterMath::cos(2.0 * w);
+    const auto &chainSettings = coefficientSet.chainSettings;
+
+    auto magnitudeSquared = 1.0;
+    for (int i = 0; i < getNumSections(chainSettings.lowCutSlope); ++i)
+        magnitudeSquared *= getMagnitudeSquared(coefficientSet.lowCut[i], cosW, cos2W);
+    if (isPeakActive(chainSettings))
+        magnitudeSquared *= getMagnitudeSquared(coefficientSet.peak, cosW, cos2W);
+    for (int i = 0; i < getNumSections(chainSettings.highCutSlope); ++i)
+        magnitudeSquared *= getMagnitudeSquared(coefficientSet.highCut[i], cosW, cos2W);
+
+    return FilterMath::sqrt(magnitudeSquared);
+}
+
+constexpr CoefficientSet makeCoefficientSet(const ChainSettings &chainSettings, double sampleRate)
+{
+    CoefficientSet coefficientSet {};
+    coefficientSet.chainSettings = chainSettings;
+    coefficientSet.peak = makePeakFilter(chainSettings, sampleRate);
+    makeLowCutFilter(chainSettings, sampleRate, coefficientSet.lowCut);
+    makeHighCutFilter(chainSettings, sampleRate, coefficientSet.highCut);
+    return coefficientSet;
+}
+
+//==============================================================================
+/**
+ The whole design has to stay constexpr, so a set is designed at compile time
+ here and checked: the peak leaves DC alone and reaches its gain at its centre
+ frequency, the low cut blocks DC and the high cut blocks Nyquist. The
+ benchmarks check the sections against juce::dsp::IIR::Coefficients.
+ */
+namespace FilterDesignChecks
+{
+    constexpr double absolute(double x) { return x < 0 ? -x : x; }
+    constexpr double getDCGain(const BiquadCoeffs &c) { return (c.b0 + c.b1 + c.b2) / (1.0 + c.a1 + c.a2); }
+    constexpr double getNyquistGain(const BiquadCoeffs &c) { return (c.b0 - c.b1 + c.b2) / (1.0 - c.a1 + c.a2); }
+
+    constexpr CoefficientSet checkSet = []
+    {
+        ChainSettings settings;
+        settings.peakFreq = 1000.f;
+        settings.peakGainInDecibels = 6.f;
+        settings.peakQuality = 1.f;
+        settings.lowCutFreq = 80.f;
+        settings.lowCutSlope = Slope_48;
+        settings.highCutFreq = 12000.f;
+        settings.highCutSlope = Slope_48;
+        return makeCoefficientSet(settings, 48000.0);
+    }();
+
+    static_assert(absolute(getDCGain(checkSet.peak) - 1.0) < 1e-12, "a peak filter must leave DC alone");
+    static_assert(absolute(getMagnitudeForFrequency(checkSet, 1000.0, 48000.0) / FilterMath::decibelsToGain(6.0) - 1.0) < 1e-2,
+                  "the chain must reach the peak gain at the peak frequency");
+    static_assert(absolute(getDCGain(checkSet.lowCut[3])) < 1e-12, "a low cut section must block DC");
+    static_assert(absolute(getNyquistGain(checkSet.highCut[3])) < 1e-12, "a high cut section must block Nyquist");
+}
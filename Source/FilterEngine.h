@@ -0,0 +1,466 @@
+/*
+  ==============================================================================
+
+    FilterEngine.h
+
+    Runs the LowCut -> Peak -> HighCut cascade on juce::dsp::SIMDRegister
+    samples. Each lane of a register carries one channel, so a group of 4 (SSE,
+    NEON) or 8 (AVX) channels goes through a single pass of the cascade instead
+    of one MonoChain per channel. The filter state is kept per group, one
+    register per state variable, i.e. channels are laid out as a structure of
+    arrays.
+
+    Each combination of low cut slope, peak on/off and high cut slope gets its
+    own instantiation of a fused kernel that runs all active sections in a
+    single pass over the block, picked when new coefficients are applied.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "FilterDesign.h"
+
+template<typename SampleType>
+struct LaneFilterChain
+{
+    using Register = juce::dsp::SIMDRegister<SampleType>;
+    static constexpr size_t numLanes = Register::SIMDNumElements;
+
+    /** the sections in chain order: 4 low cut, the peak and 4 high cut. */
+    static constexpr int peakIndex = maxCutSections;
+    static constexpr int numSections = 2 * maxCutSections + 1;
+
+    struct Section
+    {
+        Register b0, b1, b2, a1, a2;
+        Register s1, s2;
+
+        void setCoefficients(const BiquadCoeffs& c) noexcept
+        {
+            b0 = Register::expand(static_cast<SampleType>(c.b0));
+            b1 = Register::expand(static_cast<SampleType>(c.b1));
+            b2 = Register::expand(static_cast<SampleType>(c.b2));
+            a1 = Register::expand(static_cast<SampleType>(c.a1));
+            a2 = Register::expand(static_cast<SampleType>(c.a2));
+        }
+
+        void setLaneCoefficients(size_t lane, const BiquadCoeffs& c) noexcept
+        {
+            b0.set(lane, static_cast<SampleType>(c.b0));
+            b1.set(lane, static_cast<SampleType>(c.b1));
+            b2.set(lane, static_cast<SampleType>(c.b2));
+            a1.set(lane, static_cast<SampleType>(c.a1));
+            a2.set(lane, static_cast<SampleType>(c.a2));
+        }
+
+        void reset() noexcept
+        {
+            s1 = Register::expand(0);
+            s2 = Register::expand(0);
+        }
+
+        void resetLane(size_t lane) noexcept
+        {
+            s1.set(lane, 0);
+            s2.set(lane, 0);
+        }
+
+        /** transposed direct form II */
+        Register processSample(Register x) noexcept
+        {
+            const auto y = b0 * x + s1;
+            s1 = b1 * x - a1 * y + s2;
+            s2 = b2 * x - a2 * y;
+            return y;
+        }
+    };
+
+    void setCoefficients(const CoefficientSet& coefficientSet) noexcept
+    {
+        const auto& chainSettings = coefficientSet.chainSettings;
+
+        for (int i = 0; i < maxCutSections; ++i)
+        {
+            sections[i].setCoefficients(coefficientSet.lowCut[i]);
+            sections[peakIndex + 1 + i].setCoefficients(coefficientSet.highCut[i]);
+        }
+        sections[peakIndex].setCoefficients(coefficientSet.peak);
+
+        setActiveSections(getNumSections(chainSettings.lowCutSlope),
+                          isPeakActive(chainSettings),
+                          getNumSections(chainSettings.highCutSlope));
+    }
+
+    /**
+     gives one lane its own coefficients, for lanes carrying independent
+     streams. Sections this lane doesn't use become pass-through for it, and
+     the kernel covers the longest chain of all lanes.
+     */
+    void setLaneCoefficients(size_t lane, const CoefficientSet& coefficientSet) noexcept
+    {
+        const auto& chainSettings = coefficientSet.chainSettings;
+        LaneSections newSections { getNumSections(chainSettings.lowCutSlope),
+                                   isPeakActive(chainSettings),
+                                   getNumSections(chainSettings.highCutSlope) };
+        auto& oldSections = laneSections[lane];
+        const BiquadCoeffs passThrough;
+
+        for (int i = 0; i < maxCutSections; ++i)
+        {
+            updateLaneSection(lane, i, i < newSections.numLowCut ? coefficientSet.lowCut[i] : passThrough,
+                              (i < oldSections.numLowCut) != (i < newSections.numLowCut));
+            updateLaneSection(lane, peakIndex + 1 + i, i < newSections.numHighCut ? coefficientSet.highCut[i] : passThrough,
+                              (i < oldSections.numHighCut) != (i < newSections.numHighCut));
+        }
+        updateLaneSection(lane, peakIndex, newSections.peak ? coefficientSet.peak : passThrough,
+                          oldSections.peak != newSections.peak);
+
+        oldSections = newSections;
+
+        LaneSections longest { 1, false, 1 };
+        for (const auto& laneSection : laneSections)
+        {
+            longest.numLowCut = juce::jmax(longest.numLowCut, laneSection.numLowCut);
+            longest.peak = longest.peak || laneSection.peak;
+            longest.numHighCut = juce::jmax(longest.numHighCut, laneSection.numHighCut);
+        }
+        setActiveSections(longest.numLowCut, longest.peak, longest.numHighCut);
+    }
+
+    void reset() noexcept
+    {
+        for (auto& section : sections)
+            section.reset();
+    }
+
+    void resetLane(size_t lane) noexcept
+    {
+        for (auto& section : sections)
+            section.resetLane(lane);
+    }
+
+    void process(Register* samples, size_t numSamples) noexcept
+    {
+        kernel(*this, samples, numSamples);
+    }
+private:
+    using Kernel = void (*)(LaneFilterChain&, Register*, size_t);
+
+    struct LaneSections
+    {
+        int numLowCut = 1;
+        bool peak = false;
+        int numHighCut = 1;
+    };
+
+    std::array<Section, numSections> sections;
+    std::array<LaneSections, numLanes> laneSections;
+    int numLowCutSections = 1;
+    int numHighCutSections = 1;
+    bool peakActive = true;
+    Kernel kernel = &processFused<1, true, 1>;
+
+    void updateLaneSection(size_t lane, int index, const BiquadCoeffs& coefficients, bool activityChanged) noexcept
+    {
+        sections[index].setLaneCoefficients(lane, coefficients);
+        if (activityChanged)
+            sections[index].resetLane(lane);
+    }
+
+    void setActiveSections(int numLowCut, bool peak, int numHighCut) noexcept
+    {
+        // sections coming back into the chain start from silence rather than stale state
+        for (int i = numLowCutSections; i < numLowCut; ++i)
+            sections[i].reset();
+        for (int i = numHighCutSections; i < numHighCut; ++i)
+            sections[peakIndex + 1 + i].reset();
+        if (peak && !peakActive)
+            sections[peakIndex].reset();
+
+        numLowCutSections = numLowCut;
+        numHighCutSections = numHighCut;
+        peakActive = peak;
+        kernel = getKernel(numLowCut, peak, numHighCut);
+    }
+
+    /**
+     runs every active section in one pass over the samples. The section count
+     is known at compile time, so the loop over sections unrolls and the state
+     stays in registers for the whole block.
+     */
+    template<int NumLowCut, bool PeakActive, int NumHighCut>
+    static void processFused(LaneFilterChain& chain, Register* samples, size_t numSamples) noexcept
+    {
+        constexpr int numActive = NumLowCut + (PeakActive ? 1 : 0) + NumHighCut;
+
+        auto sectionIndex = [](int active)
+        {
+            if (active < NumLowCut)
+                return active;
+            if (PeakActive && active == NumLowCut)
+                return peakIndex;
+            return peakIndex + 1 + active - NumLowCut - (PeakActive ? 1 : 0);
+        };
+
+        std::array<Section, numActive> active;
+        for (int i = 0; i < numActive; ++i)
+            active[i] = chain.sections[sectionIndex(i)];
+
+        for (size_t n = 0; n < numSamples; ++n)
+        {
+            auto x = samples[n];
+            for (int i = 0; i < numActive; ++i)
+                x = active[i].processSample(x);
+            samples[n] = x;
+        }
+
+        for (int i = 0; i < numActive; ++i)
+        {
+            chain.sections[sectionIndex(i)].s1 = active[i].s1;
+            chain.sections[sectionIndex(i)].s2 = active[i].s2;
+        }
+    }
+
+    static constexpr int numKernels = maxCutSections * 2 * maxCutSections;
+
+    template<size_t... Indices>
+    static constexpr std::array<Kernel, numKernels> makeKernelTable(std::index_sequence<Indices...>)
+    {
+        return {{ &processFused<int(Indices / (2 * maxCutSections)) + 1,
+                                ((Indices / maxCutSections) % 2) == 1,
+                                int(Indices % maxCutSections) + 1>... }};
+    }
+
+    static Kernel getKernel(int numLowCut, bool peak, int numHighCut) noexcept
+    {
+        static constexpr auto kernels = makeKernelTable(std::make_index_sequence<numKernels>());
+        return kernels[size_t((numLowCut - 1) * 2 * maxCutSections + (peak ? maxCutSections : 0) + numHighCut - 1)];
+    }
+};
+
+//==============================================================================
+/**
+ Splits the channels of a block into groups of LaneFilterChain::numLanes,
+ interleaves each group into register lanes, runs the cascade once per group
+ and writes the result back. Any channel count works, from mono to immersive
+ beds, the last group just leaves its spare lanes silent.
+ */
+template<typename SampleType>
+struct FilterEngine
+{
+    using Chain = LaneFilterChain<SampleType>;
+    using Register = typename Chain::Register;
+
+    static size_t getNumGroups(size_t numChannels) { return (numChannels + Chain::numLanes - 1) / Chain::numLanes; }
+
+    void prepare(const juce::dsp::ProcessSpec& spec)
+    {
+        numChannels = spec.numChannels;
+        chains.resize(getNumGroups(numChannels));
+        interleaved.assign(spec.maximumBlockSize, Register::expand(0));
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& chain : chains)
+            chain.reset();
+    }
+
+    void setCoefficients(const CoefficientSet& coefficientSet) noexcept
+    {
+        for (auto& chain : chains)
+            chain.setCoefficients(coefficientSet);
+    }
+
+    /**
+     filters 'block' in place. Blocks longer than the prepared maximum block size
+     are filtered in chunks of that size.
+     */
+    template<typename BlockSampleType>
+    void process(juce::dsp::AudioBlock<BlockSampleType>& block) noexcept
+    {
+        const auto numSamples = block.getNumSamples();
+        if (interleaved.empty())
+            return;
+
+        for (size_t offset = 0; offset < numSamples; offset += interleaved.size())
+        {
+            auto chunk = block.getSubBlock(offset, juce::jmin(interleaved.size(), numSamples - offset));
+            processChunk(chunk);
+        }
+    }
+private:
+    std::vector<Chain> chains;
+    std::vector<Register> interleaved;
+    size_t numChannels = 0;
+
+    template<typename BlockSampleType>
+    void processChunk(juce::dsp::AudioBlock<BlockSampleType>& block) noexcept
+    {
+        const auto numSamples = block.getNumSamples();
+        const auto numBlockChannels = juce::jmin(block.getNumChannels(), numChannels);
+
+        for (size_t group = 0; group < chains.size(); ++group)
+        {
+            const auto firstChannel = group * Chain::numLanes;
+            if (firstChannel >= numBlockChannels)
+                break;
+
+            const auto numGroupChannels = juce::jmin(Chain::numLanes, numBlockChannels - firstChannel);
+            interleave(block, firstChannel, numGroupChannels);
+            chains[group].process(interleaved.data(), numSamples);
+            deinterleave(block, firstChannel, numGroupChannels);
+        }
+    }
+
+    template<typename BlockSampleType>
+    void interleave(const juce::dsp::AudioBlock<BlockSampleType>& block, size_t firstChannel, size_t numGroupChannels) noexcept
+    {
+        const auto numSamples = block.getNumSamples();
+        auto* lanes = reinterpret_cast<SampleType*>(interleaved.data());
+
+        for (size_t lane = 0; lane < Chain::numLanes; ++lane)
+        {
+            if (lane < numGroupChannels)
+            {
+                auto* source = block.getChannelPointer(firstChannel + lane);
+                for (size_t i = 0; i < numSamples; ++i)
+                    lanes[i * Chain::numLanes + lane] = static_cast<SampleType>(source[i]);
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    lanes[i * Chain::numLanes + lane] = 0;
+            }
+        }
+    }
+
+    template<typename BlockSampleType>
+    void deinterleave(juce::dsp::AudioBlock<BlockSampleType>& block, size_t firstChannel, size_t numGroupChannels) noexcept
+    {
+        const auto numSamples = block.getNumSamples();
+        const auto* lanes = reinterpret_cast<const SampleType*>(interleaved.data());
+
+        for (size_t lane = 0; lane < numGroupChannels; ++lane)
+        {
+            auto* destination = block.getChannelPointer(firstChannel + lane);
+            for (size_t i = 0; i < numSamples; ++i)
+                destination[i] = static_cast<BlockSampleType>(lanes[i * Chain::numLanes + lane]);
+        }
+    }
+};
+
+//==============================================================================
+/**
+ Runs many independent mono streams, each with its own ChainSettings, packing
+ one stream per SIMD lane. Meant for hosts and offline renderers that process
+ a whole bus of tracks at once. Streams are identified by their index: stream
+ i keeps its filter state in lane i % numLanes of group i / numLanes between
+ calls. Coefficients are only redesigned for streams whose settings changed.
+ */
+template<typename SampleType>
+struct MultiStreamFilterEngine
+{
+    using Chain = LaneFilterChain<SampleType>;
+    using Register = typename Chain::Register;
+
+    void prepare(double newSampleRate, int maximumBlockSize, int maximumNumStreams)
+    {
+        sampleRate = newSampleRate;
+        const auto numGroups = (size_t(maximumNumStreams) + Chain::numLanes - 1) / Chain::numLanes;
+        chains.resize(numGroups);
+        streamSettings.assign(numGroups * Chain::numLanes, {});
+        streamDesigned.assign(numGroups * Chain::numLanes, false);
+        interleaved.assign(size_t(maximumBlockSize), Register::expand(0));
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& chain : chains)
+            chain.reset();
+    }
+
+    /**
+     filters 'numStreams' buffers of 'numSamples' in place, stream i with settings[i].
+     */
+    template<typename StreamSampleType>
+    void processStreams(StreamSampleType* const* streams, const ChainSettings* settings, size_t numStreams, size_t numSamples) noexcept
+    {
+        jassert(numStreams <= streamSettings.size());
+        numStreams = juce::jmin(numStreams, streamSettings.size());
+        if (interleaved.empty())
+            return;
+
+        for (size_t first = 0; first < numStreams; first += Chain::numLanes)
+        {
+            const auto group = first / Chain::numLanes;
+            const auto numGroupStreams = juce::jmin(Chain::numLanes, numStreams - first);
+
+            for (size_t lane = 0; lane < numGroupStreams; ++lane)
+                updateStream(group, lane, settings[first + lane]);
+
+            for (size_t offset = 0; offset < numSamples; offset += interleaved.size())
+            {
+                const auto numChunkSamples = juce::jmin(interleaved.size(), numSamples - offset);
+                interleave(streams + first, numGroupStreams, offset, numChunkSamples);
+                chains[group].process(interleaved.data(), numChunkSamples);
+                deinterleave(streams + first, numGroupStreams, offset, numChunkSamples);
+            }
+        }
+    }
+private:
+    std::vector<Chain> chains;
+    std::vector<ChainSettings> streamSettings;
+    std::vector<bool> streamDesigned;
+    std::vector<Register> interleaved;
+    double sampleRate = 44100.0;
+
+    void updateStream(size_t group, size_t lane, const ChainSettings& settings) noexcept
+    {
+        const auto stream = group * Chain::numLanes + lane;
+        if (streamDesigned[stream] && streamSettings[stream] == settings)
+            return;
+
+        chains[group].setLaneCoefficients(lane, makeCoefficientSet(settings, sampleRate));
+        streamSettings[stream] = settings;
+        streamDesigned[stream] = true;
+    }
+
+    template<typename StreamSampleType>
+    void interleave(StreamSampleType* const* streams, size_t numGroupStreams, size_t offset, size_t numSamples) noexcept
+    {
+        auto* lanes = reinterpret_cast<SampleType*>(interleaved.data());
+
+        for (size_t lane = 0; lane < Chain::numLanes; ++lane)
+        {
+            if (lane < numGroupStreams)
+            {
+                const auto* source = streams[lane] + offset;
+                for (size_t i = 0; i < numSamples; ++i)
+                    lanes[i * Chain::numLanes + lane] = static_cast<SampleType>(source[i]);
+            }
+            else
+            {
+                for (size_t i = 0; i < numSamples; ++i)
+                    lanes[i * Chain::numLanes + lane] = 0;
+            }
+        }
+    }
+
+    template<typename StreamSampleType>
+    void deinterleave(StreamSampleType* const* streams, size_t numGroupStreams, size_t offset, size_t numSamples) noexcept
+    {
+        const auto* lanes = reinterpret_cast<const SampleType*>(interleaved.data());
+
+        for (size_t lane = 0; lane < numGroupStreams; ++lane)
+        {
+            auto* destination = streams[lane] + offset;
+            for (size_t i = 0; i < numSamples; ++i)
+                destination[i] = static_cast<StreamSampleType>(lanes[i * Chain::numLanes + lane]);
+        }
+    }
+};
@@ -0,0 +1,81 @@
+/*
+  ==============================================================================
+
+    LRUCache.h
+
+    Bounded least-recently-used map. Not thread safe on its own, wrap it in a
+    lock when it is shared.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+template<typename Key, typename Value, typename Hash = std::hash<Key>>
+struct LRUCache
+{
+    explicit LRUCache(size_t maxEntries) : capacity(maxEntries) { }
+
+    /**
+     copies the cached value into 'value' and marks the entry as most recently used.
+     */
+    bool get(const Key& key, Value& value)
+    {
+        auto found = index.find(key);
+        if (found == index.end())
+            return false;
+
+        entries.splice(entries.begin(), entries, found->second);
+        value = found->second->second;
+        return true;
+    }
+
+    void put(const Key& key, const Value& value)
+    {
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            found->second->second = value;
+            entries.splice(entries.begin(), entries, found->second);
+            return;
+        }
+
+        entries.emplace_front(key, value);
+        index[key] = entries.begin();
+        trim();
+    }
+
+    void setCapacity(size_t maxEntries)
+    {
+        capacity = maxEntries;
+        trim();
+    }
+
+    void clear()
+    {
+        index.clear();
+        entries.clear();
+    }
+
+    size_t size() const { return entries.size(); }
+    size_t getCapacity() const { return capacity; }
+private:
+    using Entry = std::pair<Key, Value>;
+
+    void trim()
+    {
+        while (entries.size() > capacity)
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    size_t capacity;
+    std::list<Entry> entries;
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+};
@@ -0,0 +1,357 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "LinearPhaseEngine.h"
+
+namespace
+{
+    // about 6 Hz between the design grid points at any sample rate, fine
+    // enough for a 48 dB/Oct low cut at 20 Hz
+    constexpr double designResolutionInHz = 6.0;
+    constexpr int minKernelSize = 4096;
+    constexpr int maxKernelSize = 32768;
+
+    int getOrder(int size) { return juce::findHighestSetBit((juce::uint32) size); }
+}
+
+void LinearPhaseEngine::prepare(double sampleRate, int numChannels)
+{
+    const auto kernelSize = juce::jlimit(minKernelSize, maxKernelSize,
+                                         juce::nextPowerOfTwo(juce::roundToInt(sampleRate / designResolutionInHz)));
+    const auto minPartitionSize = getPartitionSize(0);
+    const auto maxPartitionSize = getPartitionSize(numPartitionSizes - 1);
+
+    for (int index = 0; index < numPartitionSizes; ++index)
+    {
+        // a partition and its zero padding
+        partitionFFTs[index] = std::make_unique<juce::dsp::FFT>(getOrder(2 * getPartitionSize(index)));
+        inverseScales[index] = getInverseScale(*partitionFFTs[index]);
+    }
+
+    // the delay line holds numPartitions * (partitionSize + 1) bins, which is
+    // largest for the smallest partitions
+    const auto maxDelayLineSize = (size_t) (kernelSize + kernelSize / minPartitionSize);
+    channels.resize((size_t) numChannels);
+    for (auto &state : channels)
+    {
+        state.input.resize(2 * (size_t) maxPartitionSize);
+        state.output.resize((size_t) maxPartitionSize);
+        state.delayReal.resize(maxDelayLineSize);
+        state.delayImag.resize(maxDelayLineSize);
+    }
+
+    fftBuffer.resize(4 * (size_t) maxPartitionSize);
+    accumulatorReal.resize((size_t) maxPartitionSize + 1);
+    accumulatorImag.resize((size_t) maxPartitionSize + 1);
+    crossfadeBuffer.resize((size_t) maxPartitionSize);
+
+    preparedKernelSize = kernelSize;
+    designKernelSize.store(kernelSize);
+    designSampleRate.store(sampleRate);
+
+    // kernels for the old rate are of no use any more
+    current = nullptr;
+    activePartitionSize = 0;
+    latency.store(0);
+    reset();
+}
+
+void LinearPhaseEngine::reset() noexcept
+{
+    clearState();
+}
+
+void LinearPhaseEngine::clearState() noexcept
+{
+    for (auto &state : channels)
+    {
+        std::fill(state.input.begin(), state.input.end(), 0.f);
+        std::fill(state.output.begin(), state.output.end(), 0.f);
+        std::fill(state.delayReal.begin(), state.delayReal.end(), 0.f);
+        std::fill(state.delayImag.begin(), state.delayImag.end(), 0.f);
+    }
+    position = 0;
+    delayLineIndex = 0;
+    fadeInInput = false;
+}
+
+float LinearPhaseEngine::getInverseScale(const juce::dsp::FFT &fft)
+{
+    // whether the inverse transform divides by the size depends on the FFT
+    // engine, so measure it on a unit impulse
+    std::vector<float> buffer(2 * (size_t) fft.getSize(), 0.f);
+    buffer[0] = 1.f;
+    fft.performRealOnlyForwardTransform(buffer.data(), true);
+    fft.performRealOnlyInverseTransform(buffer.data());
+    return 1.f / buffer[0];
+}
+
+//==============================================================================
+void LinearPhaseEngine::buildKernel(const CoefficientSet &coefficientSet, int partitionSizeIndex)
+{
+    const auto sampleRate = designSampleRate.load();
+    const auto kernelSize = designKernelSize.load();
+    if (sampleRate <= 0.0 || kernelSize == 0)
+        return;
+
+    if (designFFT == nullptr || designFFT->getSize() != kernelSize)
+    {
+        designFFT = std::make_unique<juce::dsp::FFT>(getOrder(kernelSize));
+        designInverseScale = getInverseScale(*designFFT);
+    }
+
+    // zero phase spectrum: the magnitude on every bin, no imaginary part
+    designBuffer.assign(2 * (size_t) kernelSize, 0.f);
+    for (int bin = 0; bin <= kernelSize / 2; ++bin)
+    {
+        const auto frequency = bin * sampleRate / kernelSize;
+        designBuffer[2 * (size_t) bin] = (float) getMagnitudeForFrequency(coefficientSet, frequency, sampleRate);
+    }
+    designFFT->performRealOnlyInverseTransform(designBuffer.data());
+
+    // centre the impulse, which makes it causal and symmetric around
+    // kernelSize / 2, and taper it with a Blackman window to keep the
+    // truncation ripple down
+    impulse.resize((size_t) kernelSize);
+    const auto half = kernelSize / 2;
+    for (int n = 0; n < kernelSize; ++n)
+    {
+        const auto phase = 2.0 * FilterMath::pi * n / kernelSize;
+        const auto window = 0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+        impulse[(size_t) n] = designBuffer[(size_t) ((n + half) % kernelSize)] * designInverseScale * (float) window;
+    }
+
+    auto &kernel = kernels.getWriteBuffer();
+    kernel.kernelSize = kernelSize;
+    kernel.partitionSizeIndex = partitionSizeIndex;
+    kernel.partitionSize = getPartitionSize(partitionSizeIndex);
+    kernel.numPartitions = kernelSize / kernel.partitionSize;
+
+    const auto partitionSize = (size_t) kernel.partitionSize;
+    const auto numBins = partitionSize + 1;
+    kernel.real.resize(kernel.numPartitions * numBins);
+    kernel.imag.resize(kernel.numPartitions * numBins);
+
+    auto &fft = designPartitionFFTs[partitionSizeIndex];
+    if (fft == nullptr)
+        fft = std::make_unique<juce::dsp::FFT>(getOrder(2 * kernel.partitionSize));
+
+    // each partition is zero padded to twice its length before the transform
+    for (size_t partition = 0; partition < (size_t) kernel.numPartitions; ++partition)
+    {
+        designBuffer.assign(4 * partitionSize, 0.f);
+        std::copy(impulse.begin() + (std::ptrdiff_t) (partition * partitionSize),
+                  impulse.begin() + (std::ptrdiff_t) ((partition + 1) * partitionSize),
+                  designBuffer.begin());
+        fft->performRealOnlyForwardTransform(designBuffer.data(), true);
+
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            kernel.real[partition * numBins + bin] = designBuffer[2 * bin];
+            kernel.imag[partition * numBins + bin] = designBuffer[2 * bin + 1];
+        }
+    }
+
+    kernels.publish();
+}
+
+//==============================================================================
+bool LinearPhaseEngine::isUsable(const Kernel &kernel) const noexcept
+{
+    // a kernel built before the last prepare() may not fit the delay lines
+    return kernel.kernelSize == preparedKernelSize;
+}
+
+bool LinearPhaseEngine::hasKernel() noexcept
+{
+    if (activePartitionSize == 0)
+    {
+        if (auto *newest = kernels.getNewestBuffer(); newest != nullptr && isUsable(*newest))
+        {
+            current = newest;
+            clearState();
+            activePartitionSize = (size_t) current->partitionSize;
+            latency.store(current->kernelSize / 2 + current->partitionSize);
+        }
+    }
+    return activePartitionSize != 0;
+}
+
+void LinearPhaseEngine::processPartition(size_t numChannels) noexcept
+{
+    if (current != nullptr)
+    {
+        if (fadeInInput)
+        {
+            // the first partition after a restart, the window before it is silent
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto *input = channels[channel].input.data() + activePartitionSize;
+                for (size_t i = 0; i < activePartitionSize; ++i)
+                    input[i] *= (float) (i + 1) / (float) activePartitionSize;
+            }
+            fadeInInput = false;
+        }
+
+        // the slot of the oldest partition takes the newest one
+        delayLineIndex = (delayLineIndex + 1) % current->numPartitions;
+
+        for (size_t channel = 0; channel < numChannels; ++channel)
+        {
+            transformInput(channels[channel], *current);
+            convolve(*current, channels[channel], channels[channel].output.data());
+        }
+    }
+    else
+    {
+        for (size_t channel = 0; channel < numChannels; ++channel)
+            std::fill(channels[channel].output.begin(), channels[channel].output.end(), 0.f);
+    }
+
+    // only swap after the old kernel is done with, the writer may reuse it
+    // from then on
+    const auto *newest = kernels.getNewestBuffer();
+    if (newest == nullptr)
+        return;
+
+    if (!isUsable(*newest))
+    {
+        // the old kernel went back to the writer, so fade out what it made
+        // and stay silent until the next usable one
+        fadeOutOutput(numChannels, activePartitionSize);
+        current = nullptr;
+        return;
+    }
+
+    const bool samePartitioning = current != nullptr
+                               && newest->partitionSize == current->partitionSize
+                               && newest->numPartitions == current->numPartitions;
+    current = newest;
+
+    if (!samePartitioning)
+    {
+        // the delay line is laid out for the old partitions, or holds nothing
+        // useful after being muted
+        restart(numChannels, activePartitionSize);
+        return;
+    }
+
+    // the delay line is independent of the kernel, so the new kernel gets the
+    // same history and the two outputs can be faded across one partition
+    const auto partitionSize = (size_t) current->partitionSize;
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        auto *output = channels[channel].output.data();
+        convolve(*current, channels[channel], crossfadeBuffer.data());
+
+        for (size_t i = 0; i < partitionSize; ++i)
+        {
+            const auto fade = (float) (i + 1) / (float) partitionSize;
+            output[i] += fade * (crossfadeBuffer[i] - output[i]);
+        }
+    }
+}
+
+void LinearPhaseEngine::fadeOutOutput(size_t numChannels, size_t fadeLength) noexcept
+{
+    for (size_t channel = 0; channel < numChannels; ++channel)
+    {
+        auto *output = channels[channel].output.data();
+        for (size_t i = 0; i < fadeLength; ++i)
+            output[i] *= 1.f - (float) (i + 1) / (float) fadeLength;
+    }
+}
+
+void LinearPhaseEngine::restart(size_t numChannels, size_t previousPartitionSize) noexcept
+{
+    // the next partition plays the old output fading out, padded with silence
+    // when the new partitions are longer, while the input that will reach the
+    // new kernel fades in. The latency changes in the silence between the two
+    const auto partitionSize = (size_t) current->partitionSize;
+    const auto fadeLength = juce::jmin(previousPartitionSize, partitionSize);
+    fadeOutOutput(numChannels, fadeLength);
+
+    for (auto &state : channels)
+    {
+        std::fill(state.output.begin() + (std::ptrdiff_t) fadeLength, state.output.end(), 0.f);
+        std::fill(state.input.begin(), state.input.end(), 0.f);
+        std::fill(state.delayReal.begin(), state.delayReal.end(), 0.f);
+        std::fill(state.delayImag.begin(), state.delayImag.end(), 0.f);
+    }
+    delayLineIndex = 0;
+    activePartitionSize = partitionSize;
+    fadeInInput = true;
+    latency.store(current->kernelSize / 2 + current->partitionSize);
+}
+
+void LinearPhaseEngine::transformInput(ChannelState &state, const Kernel &kernel) noexcept
+{
+    const auto partitionSize = (size_t) kernel.partitionSize;
+    const auto numBins = partitionSize + 1;
+    auto *buffer = fftBuffer.data();
+
+    std::copy(state.input.begin(), state.input.begin() + (std::ptrdiff_t) (2 * partitionSize), buffer);
+    std::fill(buffer + 2 * partitionSize, buffer + 4 * partitionSize, 0.f);
+    partitionFFTs[kernel.partitionSizeIndex]->performRealOnlyForwardTransform(buffer, true);
+
+    auto *real = state.delayReal.data() + (size_t) delayLineIndex * numBins;
+    auto *imag = state.delayImag.data() + (size_t) delayLineIndex * numBins;
+    for (size_t bin = 0; bin < numBins; ++bin)
+    {
+        real[bin] = buffer[2 * bin];
+        imag[bin] = buffer[2 * bin + 1];
+    }
+
+    // overlap-save: the current partition becomes the saved half of the next window
+    std::copy(state.input.begin() + (std::ptrdiff_t) partitionSize,
+              state.input.begin() + (std::ptrdiff_t) (2 * partitionSize),
+              state.input.begin());
+}
+
+void LinearPhaseEngine::convolve(const Kernel &kernel, const ChannelState &state, float *destination) noexcept
+{
+    const auto partitionSize = (size_t) kernel.partitionSize;
+    const auto numBins = partitionSize + 1;
+    const auto numPartitions = kernel.numPartitions;
+    auto *accReal = accumulatorReal.data();
+    auto *accImag = accumulatorImag.data();
+
+    std::fill(accReal, accReal + numBins, 0.f);
+    std::fill(accImag, accImag + numBins, 0.f);
+
+    // kernel partition p meets the input transformed p partitions ago, split
+    // real and imaginary arrays keep the complex multiply-add vectorisable
+    for (int partition = 0; partition < numPartitions; ++partition)
+    {
+        const auto slot = (size_t) ((delayLineIndex - partition + numPartitions) % numPartitions);
+        const auto *xReal = state.delayReal.data() + slot * numBins;
+        const auto *xImag = state.delayImag.data() + slot * numBins;
+        const auto *hReal = kernel.real.data() + (size_t) partition * numBins;
+        const auto *hImag = kernel.imag.data() + (size_t) partition * numBins;
+
+        for (size_t bin = 0; bin < numBins; ++bin)
+        {
+            accReal[bin] += xReal[bin] * hReal[bin] - xImag[bin] * hImag[bin];
+            accImag[bin] += xReal[bin] * hImag[bin] + xImag[bin] * hReal[bin];
+        }
+    }
+
+    auto *buffer = fftBuffer.data();
+    for (size_t bin = 0; bin < numBins; ++bin)
+    {
+        buffer[2 * bin] = accReal[bin];
+        buffer[2 * bin + 1] = accImag[bin];
+    }
+    std::fill(buffer + 2 * numBins, buffer + 4 * partitionSize, 0.f);
+    partitionFFTs[kernel.partitionSizeIndex]->performRealOnlyInverseTransform(buffer);
+
+    // the first half of the window is circular wrap-around, the second half is valid
+    const auto scale = inverseScales[(size_t) kernel.partitionSizeIndex];
+    for (size_t i = 0; i < partitionSize; ++i)
+        destination[i] = buffer[partitionSize + i] * scale;
+}
@@ -0,0 +1,147 @@
+/*
+  ==============================================================================
+
+    LinearPhaseEngine.h
+
+    Linear phase version of the LowCut -> Peak -> HighCut curve. The combined
+    magnitude of the designed sections is sampled on a dense grid, turned into
+    a symmetric FIR and run with uniformly partitioned overlap-save FFT
+    convolution: the input is cut into partitions of B samples, each one is
+    transformed once and kept in a frequency domain delay line, and every
+    output partition is the sum of the delay line times the transformed kernel
+    partitions.
+
+    Kernels are built on the designer thread and handed over through a
+    TripleBuffer. A new kernel with the same partitioning is crossfaded in over
+    one partition. A different partition size restarts the convolution: the old
+    output fades out over one partition and the input fades back in. A kernel
+    that doesn't fit the prepared state fades the output out and mutes it until
+    the next one that does.
+
+    Latency is half the kernel length plus one partition.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <vector>
+#include "FilterDesign.h"
+#include "TripleBuffer.h"
+
+class LinearPhaseEngine
+{
+public:
+    /** 256, 512, 1024 and 2048 samples per partition. */
+    static constexpr int numPartitionSizes = 4;
+    static constexpr int getPartitionSize(int index) noexcept { return 256 << index; }
+
+    /** sizes the kernel for the sample rate and allocates the channel state, call before playback. */
+    void prepare(double sampleRate, int numChannels);
+    void reset() noexcept;
+
+    /**
+     builds the FIR for 'coefficientSet', designed at the prepared sample rate,
+     and publishes it to the audio thread. Allocates, never call it from the
+     audio thread, and only from one thread at a time.
+     */
+    void buildKernel(const CoefficientSet &coefficientSet, int partitionSizeIndex);
+
+    /** audio thread: picks up the first kernel, false until one has been built after prepare(). */
+    bool hasKernel() noexcept;
+    int getLatencyInSamples() const noexcept { return latency.load(); }
+
+    template<typename SampleType>
+    void process(juce::dsp::AudioBlock<SampleType> &block) noexcept
+    {
+        if (!hasKernel())
+            return;
+
+        const auto numChannels = juce::jmin(block.getNumChannels(), channels.size());
+        const auto numSamples = block.getNumSamples();
+
+        for (size_t done = 0; done < numSamples;)
+        {
+            // samples go into the second half of the input window, the output
+            // of the previous partition comes out
+            const auto partitionSize = activePartitionSize;
+            const auto chunk = juce::jmin(numSamples - done, partitionSize - position);
+
+            for (size_t channel = 0; channel < numChannels; ++channel)
+            {
+                auto *samples = block.getChannelPointer(channel) + done;
+                auto &state = channels[channel];
+                auto *input = state.input.data() + partitionSize + position;
+                const auto *output = state.output.data() + position;
+
+                for (size_t i = 0; i < chunk; ++i)
+                {
+                    input[i] = static_cast<float>(samples[i]);
+                    samples[i] = static_cast<SampleType>(output[i]);
+                }
+            }
+
+            position += chunk;
+            done += chunk;
+
+            if (position == partitionSize)
+            {
+                processPartition(numChannels);
+                position = 0;
+            }
+        }
+    }
+private:
+    struct Kernel
+    {
+        int kernelSize = 0;
+        int partitionSizeIndex = 0;
+        int partitionSize = 0;
+        int numPartitions = 0;
+
+        /** the transformed partitions, partitionSize + 1 bins each, split into real and imaginary parts. */
+        std::vector<float> real, imag;
+    };
+
+    struct ChannelState
+    {
+        std::vector<float> input;           // last two partitions of input
+        std::vector<float> output;          // the partition being played out
+        std::vector<float> delayReal;       // frequency domain delay line
+        std::vector<float> delayImag;
+    };
+
+    static float getInverseScale(const juce::dsp::FFT &fft);
+    bool isUsable(const Kernel &kernel) const noexcept;
+    void processPartition(size_t numChannels) noexcept;
+    void transformInput(ChannelState &state, const Kernel &kernel) noexcept;
+    void convolve(const Kernel &kernel, const ChannelState &state, float *destination) noexcept;
+    void fadeOutOutput(size_t numChannels, size_t fadeLength) noexcept;
+    void restart(size_t numChannels, size_t previousPartitionSize) noexcept;
+    void clearState() noexcept;
+
+    // audio thread
+    std::vector<ChannelState> channels;
+    std::array<std::unique_ptr<juce::dsp::FFT>, numPartitionSizes> partitionFFTs;
+    std::array<float, numPartitionSizes> inverseScales {};
+    std::vector<float> fftBuffer, accumulatorReal, accumulatorImag, crossfadeBuffer;
+    const Kernel *current = nullptr;        // null while muted
+    size_t activePartitionSize = 0;         // 0 until the first kernel after prepare()
+    size_t position = 0;
+    bool fadeInInput = false;
+    int delayLineIndex = 0;
+    int preparedKernelSize = 0;
+    std::atomic<int> latency { 0 };
+
+    // designer thread
+    std::atomic<double> designSampleRate { 0.0 };
+    std::atomic<int> designKernelSize { 0 };
+    std::unique_ptr<juce::dsp::FFT> designFFT;
+    float designInverseScale = 1.f;
+    std::array<std::unique_ptr<juce::dsp::FFT>, numPartitionSizes> designPartitionFFTs;
+    std::vector<float> designBuffer, impulse;
+
+    TripleBuffer<Kernel> kernels;
+};
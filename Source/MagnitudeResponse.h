@@ -0,0 +1,110 @@
+/*
+  ==============================================================================
+
+    MagnitudeResponse.h
+
+    Batch magnitude response of biquad sections over a fixed, log spaced
+    frequency grid. cos(w) and cos(2w) of every grid point are tabulated once
+    per grid and sample rate, after that each section only costs the closed
+    form |H|^2 of getMagnitudeSquared(), a few multiply-adds per point,
+    evaluated SIMDRegister<double>::size() points at a time.
+
+    SIMDRegister has no division, so a curve keeps the products of the
+    numerators and of the denominators apart and only divides when a value is
+    read out.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <vector>
+#include "FilterDesign.h"
+
+struct MagnitudeResponse
+{
+    using Register = juce::dsp::SIMDRegister<double>;
+    static constexpr size_t numLanes = Register::SIMDNumElements;
+
+    /** |H|^2 at every grid point, as the product of some sections. */
+    struct Curve
+    {
+        std::vector<Register> numerator, denominator;
+
+        double getMagnitudeSquared(int index) const noexcept
+        {
+            const auto group = (size_t) index / numLanes;
+            const auto lane = (size_t) index % numLanes;
+            return numerator[group].get(lane) / denominator[group].get(lane);
+        }
+    };
+
+    /**
+     'numPoints' points from minFrequency to maxFrequency, point i at
+     mapToLog10(i / numPoints), one per pixel column of a curve 'numPoints'
+     wide. Returns true when the grid changed and curves have to be made again.
+     */
+    bool prepare(int numPoints, double minFrequency, double maxFrequency, double sampleRate)
+    {
+        if (numPoints == gridSize && minFrequency == gridMin && maxFrequency == gridMax && sampleRate == gridSampleRate)
+            return false;
+
+        gridSize = numPoints;
+        gridMin = minFrequency;
+        gridMax = maxFrequency;
+        gridSampleRate = sampleRate;
+
+        // the tail of the last register repeats the last point, so it stays finite
+        const auto numGroups = (size_t) (numPoints + (int) numLanes - 1) / numLanes;
+        cosW.assign(numGroups, Register::expand(1.0));
+        cos2W.assign(numGroups, Register::expand(1.0));
+
+        for (size_t i = 0; i < numGroups * numLanes && numPoints > 0; ++i)
+        {
+            const auto point = juce::jmin((int) i, numPoints - 1);
+            const auto frequency = juce::mapToLog10(double(point) / double(numPoints), minFrequency, maxFrequency);
+            const auto w = 2.0 * FilterMath::pi * frequency / sampleRate;
+            cosW[i / numLanes].set(i % numLanes, std::cos(w));
+            cos2W[i / numLanes].set(i % numLanes, std::cos(2.0 * w));
+        }
+        return true;
+    }
+
+    int getNumPoints() const noexcept { return gridSize; }
+
+    /** sizes 'curve' for the grid and sets it to unity gain. */
+    void reset(Curve &curve) const
+    {
+        curve.numerator.assign(cosW.size(), Register::expand(1.0));
+        curve.denominator.assign(cosW.size(), Register::expand(1.0));
+    }
+
+    /** multiplies |H|^2 of 'numSections' sections into 'curve'. */
+    void multiply(Curve &curve, const BiquadCoeffs *sections, int numSections) const noexcept
+    {
+        jassert(curve.numerator.size() == cosW.size());
+
+        for (int s = 0; s < numSections; ++s)
+        {
+            // getMagnitudeSquared() with the coefficient terms folded together
+            const auto &c = sections[s];
+            const auto n0 = Register::expand(c.b0 * c.b0 + c.b1 * c.b1 + c.b2 * c.b2);
+            const auto n1 = Register::expand(2.0 * (c.b0 * c.b1 + c.b1 * c.b2));
+            const auto n2 = Register::expand(2.0 * c.b0 * c.b2);
+            const auto d0 = Register::expand(1.0 + c.a1 * c.a1 + c.a2 * c.a2);
+            const auto d1 = Register::expand(2.0 * (c.a1 + c.a1 * c.a2));
+            const auto d2 = Register::expand(2.0 * c.a2);
+
+            for (size_t i = 0; i < cosW.size(); ++i)
+            {
+                curve.numerator[i] *= n0 + n1 * cosW[i] + n2 * cos2W[i];
+                curve.denominator[i] *= d0 + d1 * cosW[i] + d2 * cos2W[i];
+            }
+        }
+    }
+private:
+    int gridSize = 0;
+    double gridMin = 0.0, gridMax = 0.0, gridSampleRate = 0.0;
+    std::vector<Register> cosW, cos2W;
+};
@@ -134,10 +134,18 @@ juce::String RotarySliderWithLabels::getDisplayString() const {
     return string;
 }
 
+namespace
+{
+    /** the MaxFrameRate setting in Hz, the analyzer and the repaints never go faster. */
+    int getMaxFrameRate(const AnalyzerSettings& settings)
+    {
+        static constexpr int frameRates[] { 15, 30, 60, 120 };
+        return frameRates[juce::jlimit(0, 3, settings.get(AnalyzerSettings::MaxFrameRate))];
+    }
+}
+
 ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) :
-    audioProcessor(p),
-    leftPathProducer(audioProcessor.leftChannelFifo),
-    rightPathProducer(audioProcessor.rightChannelFifo)
+    audioProcessor(p)
 {
     const auto& params = audioProcessor.getParameters();
     for (auto param : params)
@@ -146,7 +154,7 @@ ResponseCurveComponent::ResponseCurveComponent(SimpleEQAudioProcessor& p) :
     }
     
     updateChain();
-    startTimerHz(60);
+    setFrameRate(getMaxFrameRate(audioProcessor.analyzerSettings));
 }
 ResponseCurveComponent::~ResponseCurveComponent()
 {
@@ -164,75 +172,90 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
     
     g.drawImage(background, getLocalBounds().toFloat());
     
+    // fft analyser, drawn by the analyzer thread over the render area, which
+    // is all the timer repaints
+    if (analyzerThread != nullptr)
+    {
+        const auto& analyzerImage = analyzerThread->getSnapshot().image;
+        if (analyzerImage.isValid())
+            g.drawImage(analyzerImage, getRenderArea().toFloat());
+    }
+    
+    g.drawImage(overlay, getLocalBounds().toFloat());
+}
+
+void ResponseCurveComponent::updateResponseCurve()
+{
     auto responseArea = getAnalysisArea();
     auto width = responseArea.getWidth();
-    auto& lowCut = monoChain.get<ChainPositions::LowCut>();
-    auto& peak = monoChain.get<ChainPositions::Peak>();
-    auto& highCut = monoChain.get<ChainPositions::HighCut>();
-    
-    auto sampleRate = audioProcessor.getSampleRate();
-    std::vector<double> magnitudes;
-    magnitudes.resize(width);
-    for (int i = 0; i < width; ++i) {
-        double magnitude = 1.f;
-        auto frequency = juce::mapToLog10(double(i) / double(width), 20.0, 20000.0);
-        
-        if (!monoChain.isBypassed<ChainPositions::Peak>()) {
-            magnitude *= peak.coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<0>()) {
-            magnitude *= lowCut.get<0>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<1>()) {
-            magnitude *= lowCut.get<1>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<2>()) {
-            magnitude *= lowCut.get<2>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!lowCut.isBypassed<3>()) {
-            magnitude *= lowCut.get<3>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<0>()) {
-            magnitude *= highCut.get<0>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<1>()) {
-            magnitude *= highCut.get<1>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<2>()) {
-            magnitude *= highCut.get<2>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
-        if (!highCut.isBypassed<3>()) {
-            magnitude *= highCut.get<3>().coefficients->getMagnitudeForFrequency(frequency, sampleRate);
-        }
+    if (width <= 0)
+        return;
+    
+    // a new width or sample rate moves every grid point
+    if (magnitudeResponse.prepare(width, 20.0, 20000.0, designSampleRate))
+        stageNeedsUpdate.fill(true);
+    
+    const auto& chainSettings = responseCoefficients.chainSettings;
+    bool curveNeedsUpdate = false;
+    for (int stage = 0; stage < numResponseStages; ++stage)
+    {
+        if (!stageNeedsUpdate[stage])
+            continue;
+        
+        auto& curve = stageCurves[stage];
+        magnitudeResponse.reset(curve);
+        
+        if (stage == LowCutStage)
+            magnitudeResponse.multiply(curve, responseCoefficients.lowCut.data(), getNumSections(chainSettings.lowCutSlope));
+        else if (stage == HighCutStage)
+            magnitudeResponse.multiply(curve, responseCoefficients.highCut.data(), getNumSections(chainSettings.highCutSlope));
+        else
+            magnitudeResponse.multiply(curve, &responseCoefficients.peak, 1);
         
-        magnitudes[i] = juce::Decibels::gainToDecibels(magnitude);
+        stageNeedsUpdate[stage] = false;
+        curveNeedsUpdate = true;
     }
     
-    juce::Path responseCurve;
+    if (!curveNeedsUpdate)
+        return;
+    
     const double outputMin = responseArea.getBottom();
     const double outputMax = responseArea.getY();
     auto map = [outputMin, outputMax](double input)
     {
         return juce::jmap(input, -24.0, 24.0, outputMin, outputMax);
     };
+    auto getDecibels = [this](int i)
+    {
+        return juce::Decibels::gainToDecibels(std::sqrt(stageCurves[LowCutStage].getMagnitudeSquared(i)
+                                                        * stageCurves[PeakStage].getMagnitudeSquared(i)
+                                                        * stageCurves[HighCutStage].getMagnitudeSquared(i)));
+    };
     
-    responseCurve.startNewSubPath(responseArea.getX(), map(magnitudes.front()));
-    for (size_t i = 1; i < magnitudes.size(); ++i)
+    responseCurve.clear();
+    responseCurve.startNewSubPath(responseArea.getX(), map(getDecibels(0)));
+    for (int i = 1; i < width; ++i)
     {
-        responseCurve.lineTo(responseArea.getX() + i, map(magnitudes[i]));
+        responseCurve.lineTo(responseArea.getX() + i, map(getDecibels(i)));
     }
+    updateOverlay();
+}
+
+void ResponseCurveComponent::updateOverlay()
+{
+    if (getLocalBounds().isEmpty())
+        return;
+    
+    const auto scale = juce::Component::getApproximateScaleFactorForComponent(this);
+    const auto width = juce::roundToInt(getWidth() * scale);
+    const auto height = juce::roundToInt(getHeight() * scale);
+    if (overlay.getWidth() != width || overlay.getHeight() != height)
+        overlay = juce::Image(juce::Image::PixelFormat::ARGB, width, height, true);
+    else
+        overlay.clear(overlay.getBounds());
     
-    // fft analyser
-    auto leftChannelFFTPath = leftPathProducer.getPath();
-    leftChannelFFTPath.applyTransform(juce::AffineTransform().translation(responseArea.getX(), responseArea.getY()));
-    g.setColour(juce::Colours::skyblue);
-    g.strokePath(leftChannelFFTPath, juce::PathStrokeType(1.f));
-    auto rightChannelFFTPath = rightPathProducer.getPath();
-    rightChannelFFTPath.applyTransform(juce::AffineTransform().translation(responseArea.getX(), responseArea.getY()));
-    g.setColour(juce::Colours::yellow);
-    g.strokePath(rightChannelFFTPath, juce::PathStrokeType(1.f));
-    
-    // grid
+    juce::Graphics g(overlay);
+    g.addTransform(juce::AffineTransform::scale(scale));
     g.setColour(juce::Colours::orange);
     g.drawRoundedRectangle(getRenderArea().toFloat(), 4.f, 1.f);
     g.setColour(juce::Colours::white);
@@ -241,9 +264,44 @@ void ResponseCurveComponent::paint (juce::Graphics& g)
 
 void ResponseCurveComponent::resized()
 {
-    background = juce::Image(juce::Image::PixelFormat::RGB, getWidth(), getHeight(), true);
-    juce::Graphics g(background);
+    // every column moves
+    stageNeedsUpdate.fill(true);
+    updateResponseCurve();
+    
+    // the analyzer gets its new layout along with the new grid
+    background = juce::Image();
+    updateDisplayResources();
+}
+
+bool ResponseCurveComponent::updateDisplayResources()
+{
+    if (!isShowing() || getLocalBounds().isEmpty())
+        return false;
+    
+    if (analyzerThread == nullptr)
+    {
+        analyzerThread = std::make_unique<AnalyzerThread>(audioProcessor);
+    }
     
+    if (background.isNull() || backgroundScale != juce::Component::getApproximateScaleFactorForComponent(this))
+    {
+        updateBackground();
+        updateOverlay();
+        analyzerThread->setLayout({ getRenderArea(), getAnalysisArea(), backgroundScale });
+        return true;
+    }
+    return false;
+}
+
+void ResponseCurveComponent::updateBackground()
+{
+    backgroundScale = juce::Component::getApproximateScaleFactorForComponent(this);
+    background = gridImages->getImage(getWidth(), getHeight(), backgroundScale,
+                                      [this](juce::Graphics& g) { drawGrid(g); });
+}
+
+void ResponseCurveComponent::drawGrid(juce::Graphics& g)
+{
     juce::Array<float> frequencies
     {
         20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000
@@ -354,72 +412,219 @@ juce::Rectangle<int> ResponseCurveComponent::getAnalysisArea()
 void ResponseCurveComponent::parameterValueChanged(int parameterIndex, float newValue)
 {
     parametersChanged.set(true);
+    
+    // a slider being dragged calls from the message thread, so an idle timer
+    // can wake up straight away instead of on its next tick
+    if (juce::MessageManager::existsAndIsCurrentThread())
+    {
+        idleTicks = 0;
+        setFrameRate(getMaxFrameRate(audioProcessor.analyzerSettings));
+    }
+}
+
+void ResponseCurveComponent::setFrameRate(int framesPerSecond)
+{
+    if (getTimerInterval() != 1000 / framesPerSecond)
+        startTimer(1000 / framesPerSecond);
 }
 
-void PathProducer::process(juce::Rectangle<float> fftBounds, double sampleRate)
+bool PathProducer::pullSamples(int hopSize)
 {
-    juce::AudioBuffer<float> tempBuffer;
+    const auto numSamples = monoBuffer.getNumSamples();
+    const auto numReady = leftChannelFifo->getNumSamplesAvailable();
     
-    while(leftChannelFifo->getNumCompleteBuffersAvailable() > 0)
+    // anything older than one window would be shifted straight out again
+    leftChannelFifo->skipSamples(numReady - numSamples);
+    
+    // only the samples go into the window, straight out of the ring, the FFT
+    // waits until everything that has piled up is in
+    leftChannelFifo->readSamples(juce::jmin(numReady, numSamples), [this, numSamples](const float* samples, int size)
     {
-        if (leftChannelFifo->getAudioBuffer(tempBuffer)) {
-            auto size = tempBuffer.getNumSamples();
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
-                                              monoBuffer.getReadPointer(0, size),
-                                              monoBuffer.getNumSamples() - size);
-            
-            juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, monoBuffer.getNumSamples() - size),
-                                              tempBuffer.getReadPointer(0, 0),
-                                              size);
-            
-            leftChannelFFTDataGenerator.produceFFTDataForRendering(monoBuffer, -48.f);
-        }
-    }
-    const auto fftSize = leftChannelFFTDataGenerator.getFFTSize();
+        juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, 0),
+                                          monoBuffer.getReadPointer(0, size),
+                                          numSamples - size);
+        
+        juce::FloatVectorOperations::copy(monoBuffer.getWritePointer(0, numSamples - size),
+                                          samples,
+                                          size);
+    });
+    samplesSinceLastFrame += numReady;
+    
+    return samplesSinceLastFrame >= hopSize;
+}
+
+void PathProducer::generatePath(const std::vector<float>& fftData, juce::Rectangle<float> fftBounds, int fftSize, double sampleRate)
+{
+    samplesSinceLastFrame = 0;
+    
     const auto binWidth = sampleRate / (double)fftSize;
+    pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f, leftChannelFFTPath);
+}
+
+AnalyzerThread::AnalyzerThread(SimpleEQAudioProcessor& p) :
+    juce::Thread("SimpleEQ Analyzer"),
+    audioProcessor(p),
+    leftPathProducer(audioProcessor.leftChannelFifo),
+    rightPathProducer(audioProcessor.rightChannelFifo)
+{
+    audioProcessor.addAnalyzerClient();
+    startThread();
+}
+
+AnalyzerThread::~AnalyzerThread()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread(1000);
+    audioProcessor.removeAnalyzerClient();
+}
+
+void AnalyzerThread::setLayout(const Layout& newLayout)
+{
+    const juce::SpinLock::ScopedLockType sl(layoutLock);
+    layout = newLayout;
+}
+
+void AnalyzerThread::renderImage(Snapshot& snapshot)
+{
+    const auto& frameLayout = snapshot.layout;
+    const auto width = juce::roundToInt(frameLayout.renderArea.getWidth() * frameLayout.scale);
+    const auto height = juce::roundToInt(frameLayout.renderArea.getHeight() * frameLayout.scale);
     
-    while(leftChannelFFTDataGenerator.getNumAvailableFFTDataBlocks() > 0)
+    // a software image, so drawing into it off the message thread is safe
+    if (snapshot.image.getWidth() != width || snapshot.image.getHeight() != height)
+        snapshot.image = juce::Image(juce::Image::PixelFormat::ARGB, width, height, true, juce::SoftwareImageType());
+    else
+        snapshot.image.clear(snapshot.image.getBounds());
+    
+    // the paths are relative to the analysis area, the image covers the render area
+    juce::Graphics g(snapshot.image);
+    g.addTransform(juce::AffineTransform::scale(frameLayout.scale));
+    const auto transform = juce::AffineTransform::translation(frameLayout.analysisArea.getPosition()
+                                                              - frameLayout.renderArea.getPosition());
+    g.setColour(juce::Colours::skyblue);
+    g.strokePath(snapshot.left, juce::PathStrokeType(1.f), transform);
+    g.setColour(juce::Colours::yellow);
+    g.strokePath(snapshot.right, juce::PathStrokeType(1.f), transform);
+}
+
+void AnalyzerThread::run()
+{
+    while (!threadShouldExit())
     {
-        std::vector<float> fftData;
-        if(leftChannelFFTDataGenerator.getFFTData(fftData))
+        // no point producing paths faster than the display shows them
+        wait(1000 / getMaxFrameRate(audioProcessor.analyzerSettings));
+        
+        Layout frameLayout;
         {
-            pathProducer.generatePath(fftData, fftBounds, fftSize, binWidth, -48.f);
+            const juce::SpinLock::ScopedLockType sl(layoutLock);
+            frameLayout = layout;
         }
+        const auto fftBounds = frameLayout.analysisArea.toFloat();
+        
+        // the host thread writes getSampleRate() in prepareToPlay, this is the atomic copy
+        const auto sampleRate = audioProcessor.getPreparedSampleRate();
+        if (fftBounds.isEmpty() || sampleRate <= 0.0)
+            continue;
+        
+        const auto resolution = audioProcessor.analyzerSettings.get(AnalyzerSettings::Resolution);
+        const auto order = static_cast<FFTOrder>(FFTOrder::order2048 + resolution);
+        if (order != fftDataGenerator.getOrder())
+            fftDataGenerator.changeOrder(order);
+        
+        const auto fftSize = fftDataGenerator.getFFTSize();
+        const auto overlap = 0.25f * audioProcessor.analyzerSettings.get(AnalyzerSettings::Overlap);
+        const auto hopSize = juce::jmax(1, juce::roundToInt(fftSize * (1.f - overlap)));
+        
+        // both windows always hold the newest samples, so one frame due is enough
+        auto leftDue = leftPathProducer.pullSamples(hopSize);
+        auto rightDue = rightPathProducer.pullSamples(hopSize);
+        if (!leftDue && !rightDue)
+            continue;
+        
+        // one complex FFT for both channels
+        const auto midSide = audioProcessor.analyzerSettings.get(AnalyzerSettings::Mode) == 1;
+        fftDataGenerator.produceFFTDataForRendering(leftPathProducer.getWindow(), rightPathProducer.getWindow(), -48.f, midSide);
+        
+        using Spectrum = StereoFFTDataGenerator::Spectrum;
+        leftPathProducer.generatePath(fftDataGenerator.getFFTData(midSide ? Spectrum::Mid : Spectrum::Left), fftBounds, fftSize, sampleRate);
+        rightPathProducer.generatePath(fftDataGenerator.getFFTData(midSide ? Spectrum::Side : Spectrum::Right), fftBounds, fftSize, sampleRate);
+        
+        // silence or a steady tone gives the same paths over and over, they
+        // would only cause repaints
+        if (lastPublished != nullptr
+            && frameLayout == lastPublished->layout
+            && leftPathProducer.getPath() == lastPublished->left
+            && rightPathProducer.getPath() == lastPublished->right)
+            continue;
+        
+        // the paths trade places with the ones in the write buffer, whose
+        // storage the producers build the next frame into, so a steady frame
+        // rate doesn't allocate
+        auto& snapshot = snapshots.getWriteBuffer();
+        leftPathProducer.swapPath(snapshot.left);
+        rightPathProducer.swapPath(snapshot.right);
+        snapshot.layout = frameLayout;
+        renderImage(snapshot);
+        snapshots.publish();
+        lastPublished = &snapshot;
     }
-    
-    while(pathProducer.getNumPathsAvailable())
-    {
-        pathProducer.getPath(leftChannelFFTPath);
-    }
-    
 }
+
 void ResponseCurveComponent::timerCallback()
 {
-    auto fftBounds = getAnalysisArea().toFloat();
-    auto sampleRate = audioProcessor.getSampleRate();
+    // the window may have moved to a display with another scale
+    if (updateDisplayResources())
+    {
+        repaint();
+    }
     
-    leftPathProducer.process(fftBounds, sampleRate);
-    rightPathProducer.process(fftBounds, sampleRate);
+    // the analyzer thread has done the work, just take its newest paths
+    bool needsRepaint = analyzerThread != nullptr && analyzerThread->getNewSnapshot() != nullptr;
     
     if (parametersChanged.compareAndSetBool(false, true))
     {
         updateChain();
+        updateResponseCurve();
+        needsRepaint = true;
     }
     
-    // signal a repaint
-    repaint();
+    // only the plot changes, the rest of the component stays as it is
+    if (needsRepaint)
+    {
+        idleTicks = 0;
+        repaint(getRenderArea().expanded(1));
+    }
+    else
+    {
+        ++idleTicks;
+    }
+    
+    // full rate while things move, idle after half a second without changes
+    const auto maxFrameRate = getMaxFrameRate(audioProcessor.analyzerSettings);
+    setFrameRate(idleTicks > maxFrameRate / 2 ? juce::jmin(idleFrameRate, maxFrameRate) : maxFrameRate);
 }
 
 void ResponseCurveComponent::updateChain()
 {
     auto chainSettings = getChainSettings(audioProcessor.apvts);
-    auto peakCoefficients = makePeakFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCoefficients(monoChain.get<ChainPositions::Peak>().coefficients, peakCoefficients);
+    auto newDesignSampleRate = getDesignSampleRate(chainSettings, audioProcessor.getSampleRate());
+    
+    // only the stages whose settings moved need their curves again
+    if (newDesignSampleRate != designSampleRate)
+    {
+        stageNeedsUpdate.fill(true);
+    }
+    else
+    {
+        const auto& old = responseCoefficients.chainSettings;
+        stageNeedsUpdate[LowCutStage] |= chainSettings.lowCutFreq != old.lowCutFreq || chainSettings.lowCutSlope != old.lowCutSlope;
+        stageNeedsUpdate[PeakStage] |= chainSettings.peakFreq != old.peakFreq || chainSettings.peakGainInDecibels != old.peakGainInDecibels || chainSettings.peakQuality != old.peakQuality;
+        stageNeedsUpdate[HighCutStage] |= chainSettings.highCutFreq != old.highCutFreq || chainSettings.highCutSlope != old.highCutSlope;
+    }
+    designSampleRate = newDesignSampleRate;
     
-    auto lowCutCoefficients = makeLowCutFilter(chainSettings, audioProcessor.getSampleRate());
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, audioProcessor.getSampleRate());
-    updateCutFilter(monoChain.get<ChainPositions::LowCut>(), lowCutCoefficients, chainSettings.lowCutSlope);
-    updateCutFilter(monoChain.get<ChainPositions::HighCut>(), highCutCoefficients, chainSettings.highCutSlope);
+    responseCoefficients = makeCoefficientSet(chainSettings, designSampleRate);
 }
 
 SimpleEQAudioProcessorEditor::SimpleEQAudioProcessorEditor (SimpleEQAudioProcessor& p)
@@ -487,8 +692,14 @@ void SimpleEQAudioProcessorEditor::resized()
     auto heightRatio = 25.f  / 100.f; // JUCE_LIVE_CONSTANT(25) / 100.f;
     auto responseArea = bounds.removeFromTop(bounds.getHeight() * heightRatio);
     responseCurveComponent.setBounds(responseArea);
-    
-    bounds.removeFromTop(16);
+    analyzerControlsComponent.setBounds(bounds.removeFromTop(24));
+    
+    auto statsArea = bounds.removeFromTop(16);
+#if SIMPLEEQ_REALTIME_MONITOR
+    realtimeStatsComponent.setBounds(statsArea);
+#else
+    juce::ignoreUnused(statsArea);
+#endif
     auto lowCutArea = bounds.removeFromLeft(bounds.getWidth() * 0.33);
     auto highCutArea = bounds.removeFromRight(bounds.getWidth() * 0.5);
     lowCutFreqSlider.setBounds(lowCutArea.removeFromTop(lowCutArea.getHeight() * 0.5));
@@ -511,6 +722,97 @@ std::vector<juce::Component*> SimpleEQAudioProcessorEditor::getComponents()
         &lowCutSlopeSlider,
         &highCutFreqSlider,
         &highCutSlopeSlider,
-        &responseCurveComponent
+        &responseCurveComponent,
+        &analyzerControlsComponent,
+#if SIMPLEEQ_REALTIME_MONITOR
+        &realtimeStatsComponent,
+#endif
     };
 }
+
+AnalyzerControlsComponent::AnalyzerControlsComponent(SimpleEQAudioProcessor& p) :
+    audioProcessor(p)
+{
+    for (int i = 0; i < AnalyzerSettings::numSettings; ++i)
+    {
+        const auto setting = static_cast<AnalyzerSettings::Setting>(i);
+        auto& label = labels[(size_t) i];
+        auto& box = boxes[(size_t) i];
+        
+        label.setText(AnalyzerSettings::getName(setting), juce::dontSendNotification);
+        label.setJustificationType(juce::Justification::centredRight);
+        label.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
+        
+        box.addItemList(AnalyzerSettings::getChoices(setting), 1);
+        box.setSelectedItemIndex(audioProcessor.analyzerSettings.get(setting), juce::dontSendNotification);
+        box.onChange = [this, setting, &box]
+        {
+            audioProcessor.analyzerSettings.set(audioProcessor.apvts.state, setting, box.getSelectedItemIndex());
+        };
+        
+        addAndMakeVisible(label);
+        addAndMakeVisible(box);
+    }
+    
+    audioProcessor.apvts.state.addListener(this);
+}
+
+AnalyzerControlsComponent::~AnalyzerControlsComponent()
+{
+    audioProcessor.apvts.state.removeListener(this);
+    cancelPendingUpdate();
+}
+
+void AnalyzerControlsComponent::resized()
+{
+    auto bounds = getLocalBounds();
+    const auto width = bounds.getWidth() / AnalyzerSettings::numSettings;
+    for (size_t i = 0; i < boxes.size(); ++i)
+    {
+        auto area = bounds.removeFromLeft(width).reduced(2);
+        labels[i].setBounds(area.removeFromLeft(area.getWidth() * 0.45));
+        boxes[i].setBounds(area);
+    }
+}
+
+void AnalyzerControlsComponent::valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property)
+{
+    // the parameters change properties of the child trees, the settings live on the root
+    if (tree == audioProcessor.apvts.state)
+    {
+        triggerAsyncUpdate();
+    }
+}
+
+void AnalyzerControlsComponent::handleAsyncUpdate()
+{
+    for (int i = 0; i < AnalyzerSettings::numSettings; ++i)
+    {
+        const auto setting = static_cast<AnalyzerSettings::Setting>(i);
+        boxes[(size_t) i].setSelectedItemIndex(audioProcessor.analyzerSettings.get(setting), juce::dontSendNotification);
+    }
+}
+
+#if SIMPLEEQ_REALTIME_MONITOR
+void RealtimeStatsComponent::timerCallback()
+{
+    stats = audioProcessor.getRealtimeStats();
+    repaint();
+}
+
+void RealtimeStatsComponent::paint(juce::Graphics& g)
+{
+    juce::String text;
+    text << "load p99 " << juce::roundToInt(stats.p99Load * 100.f) << "%"
+         << ", worst " << juce::roundToInt(stats.worstLoad * 100.f) << "% (" << juce::String(stats.worstMilliseconds, 2) << " ms)"
+         << ", missed " << (juce::int64) stats.deadlineMisses << " of " << (juce::int64) stats.numBlocks
+         << ", allocations " << (juce::int64) (stats.allocations + stats.deallocations)
+         << ", locks " << (juce::int64) stats.blockingCalls;
+    
+    const bool clean = stats.deadlineMisses == 0 && stats.allocations == 0
+                    && stats.deallocations == 0 && stats.blockingCalls == 0;
+    g.setColour(clean ? juce::Colours::lightgrey : juce::Colours::red);
+    g.setFont(12);
+    g.drawFittedText(text, getLocalBounds(), juce::Justification::centred, 1);
+}
+#endif
@@ -10,6 +10,9 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "TripleBuffer.h"
+#include "MagnitudeResponse.h"
+#include "LRUCache.h"
 enum FFTOrder
 {
     order2048 = 11,
@@ -17,104 +20,166 @@ enum FFTOrder
     order8192 = 13
 };
 
-template<typename BlockType>
-struct FFTDataGenerator
+/**
+ the FFT plans and Blackman-Harris tables for every analyzer order, built once
+ and shared by all channels and plugin instances through a
+ juce::SharedResourcePointer. Analysing only reads them, so any number of
+ threads can use them at the same time.
+ */
+struct AnalyzerFFTPlans
 {
+    static constexpr int numOrders = FFTOrder::order8192 - FFTOrder::order2048 + 1;
+    static constexpr int maxFFTSize = 1 << FFTOrder::order8192;
+    
+    AnalyzerFFTPlans()
+    {
+        for (int i = 0; i < numOrders; ++i)
+        {
+            const auto order = FFTOrder::order2048 + i;
+            ffts[i] = std::make_unique<juce::dsp::FFT>(order);
+            windows[i] = std::make_unique<juce::dsp::WindowingFunction<float>>(size_t(1) << order, juce::dsp::WindowingFunction<float>::blackmanHarris);
+        }
+    }
+    
+    const juce::dsp::FFT& getFFT(FFTOrder order) const { return *ffts[order - FFTOrder::order2048]; }
+    const juce::dsp::WindowingFunction<float>& getWindow(FFTOrder order) const { return *windows[order - FFTOrder::order2048]; }
+private:
+    std::array<std::unique_ptr<juce::dsp::FFT>, numOrders> ffts;
+    std::array<std::unique_ptr<juce::dsp::WindowingFunction<float>>, numOrders> windows;
+};
+
+/**
+ Both channels with one complex FFT: left goes into the real part, right into
+ the imaginary part, and the two spectra are separated afterwards using the
+ symmetry of real signals,
+
+     L[k] = (Z[k] + conj(Z[N - k])) / 2
+     R[k] = (Z[k] - conj(Z[N - k])) / 2i
+
+ so a stereo frame costs one FFT instead of two. Mid and side come from the
+ same spectra, M = (L + R) / 2 and S = (L - R) / 2, for a few adds per bin.
+ Each bin is scaled by the number of bins and converted to decibels.
+ */
+struct StereoFFTDataGenerator
+{
+    enum Spectrum { Left, Right, Mid, Side, numSpectra };
+    
+    StereoFFTDataGenerator()
+    {
+        // sized for the largest order, so changing order never allocates
+        windowed.resize(AnalyzerFFTPlans::maxFFTSize);
+        packed.resize(AnalyzerFFTPlans::maxFFTSize);
+        transformed.resize(AnalyzerFFTPlans::maxFFTSize);
+        for( auto& spectrum : spectra )
+            spectrum.resize(AnalyzerFFTPlans::maxFFTSize / 2, 0);
+        
+        changeOrder(FFTOrder::order2048);
+    }
+    
     /**
-     produces the FFT data from an audio buffer.
+     transforms the newest getFFTSize() samples of both buffers, and makes
+     either the left/right or the mid/side spectra.
      */
-    void produceFFTDataForRendering(const juce::AudioBuffer<float>& audioData, const float negativeInfinity)
+    void produceFFTDataForRendering(const juce::AudioBuffer<float>& left,
+                                    const juce::AudioBuffer<float>& right,
+                                    const float negativeInfinity,
+                                    bool midSide)
     {
         const auto fftSize = getFFTSize();
+        const auto numBins = fftSize / 2;
+        jassert(left.getNumSamples() >= fftSize && right.getNumSamples() >= fftSize);
         
-        fftData.assign(fftData.size(), 0);
-        auto* readIndex = audioData.getReadPointer(0);
-        std::copy(readIndex, readIndex + fftSize, fftData.begin());
+        // window each channel and pack the pair into one complex signal
+        juce::FloatVectorOperations::copy(windowed.data(), left.getReadPointer(0, left.getNumSamples() - fftSize), fftSize);
+        window->multiplyWithWindowingTable(windowed.data(), (size_t)fftSize);
+        for( int i = 0; i < fftSize; ++i )
+            packed[(size_t)i].real(windowed[(size_t)i]);
         
-        // first apply a windowing function to our data
-        window->multiplyWithWindowingTable (fftData.data(), fftSize);       // [1]
+        juce::FloatVectorOperations::copy(windowed.data(), right.getReadPointer(0, right.getNumSamples() - fftSize), fftSize);
+        window->multiplyWithWindowingTable(windowed.data(), (size_t)fftSize);
+        for( int i = 0; i < fftSize; ++i )
+            packed[(size_t)i].imag(windowed[(size_t)i]);
         
-        // then render our FFT data..
-        forwardFFT->performFrequencyOnlyForwardTransform (fftData.data());  // [2]
+        forwardFFT->perform(packed.data(), transformed.data(), false);
         
-        int numBins = (int)fftSize / 2;
+        auto& first = spectra[midSide ? Mid : Left];
+        auto& second = spectra[midSide ? Side : Right];
         
-        //normalize the fft values.
-        for( int i = 0; i < numBins; ++i )
+        for( int k = 0; k < numBins; ++k )
         {
-            auto v = fftData[i];
-//            fftData[i] /= (float) numBins;
-            if( !std::isinf(v) && !std::isnan(v) )
-            {
-                v /= float(numBins);
-            }
-            else
+            const auto z = transformed[(size_t)k];
+            const auto mirrored = std::conj(transformed[(size_t)((fftSize - k) % fftSize)]);
+            
+            auto l = (z + mirrored) * 0.5f;
+            auto r = (z - mirrored) * juce::dsp::Complex<float>(0.f, -0.5f);
+            if( midSide )
             {
-                v = 0.f;
+                const auto mid = (l + r) * 0.5f;
+                r = (l - r) * 0.5f;
+                l = mid;
             }
-            fftData[i] = v;
+            
+            first[(size_t)k] = toDecibels(std::abs(l), numBins, negativeInfinity);
+            second[(size_t)k] = toDecibels(std::abs(r), numBins, negativeInfinity);
         }
-        
-        //convert them to decibels
-        for( int i = 0; i < numBins; ++i )
-        {
-            fftData[i] = juce::Decibels::gainToDecibels(fftData[i], negativeInfinity);
-        }
-        
-        fftDataFifo.push(fftData);
     }
     
     void changeOrder(FFTOrder newOrder)
     {
-        //when you change order, recreate the window, forwardFFT, fifo, fftData
-        //also reset the fifoIndex
-        //things that need recreating should be created on the heap via std::make_unique<>
-        
         order = newOrder;
-        auto fftSize = getFFTSize();
-        
-        forwardFFT = std::make_unique<juce::dsp::FFT>(order);
-        window = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::blackmanHarris);
-        
-        fftData.clear();
-        fftData.resize(fftSize * 2, 0);
-
-        fftDataFifo.prepare(fftData.size());
+        forwardFFT = &plans->getFFT(order);
+        window = &plans->getWindow(order);
     }
     //==============================================================================
     int getFFTSize() const { return 1 << order; }
-    int getNumAvailableFFTDataBlocks() const { return fftDataFifo.getNumAvailableForReading(); }
-    //==============================================================================
-    bool getFFTData(BlockType& fftData) { return fftDataFifo.pull(fftData); }
+    FFTOrder getOrder() const { return order; }
+    /** the newest frame of one spectrum, getFFTSize() / 2 bins of it are valid. */
+    const std::vector<float>& getFFTData(Spectrum spectrum) const { return spectra[spectrum]; }
 private:
-    FFTOrder order;
-    BlockType fftData;
-    std::unique_ptr<juce::dsp::FFT> forwardFFT;
-    std::unique_ptr<juce::dsp::WindowingFunction<float>> window;
+    FFTOrder order = FFTOrder::order2048;
+    juce::SharedResourcePointer<AnalyzerFFTPlans> plans;
+    const juce::dsp::FFT* forwardFFT = nullptr;
+    const juce::dsp::WindowingFunction<float>* window = nullptr;
+    
+    std::vector<float> windowed;
+    std::vector<juce::dsp::Complex<float>> packed, transformed;
+    std::array<std::vector<float>, numSpectra> spectra;
     
-    Fifo<BlockType> fftDataFifo;
+    static float toDecibels(float magnitude, int numBins, float negativeInfinity)
+    {
+        if( std::isinf(magnitude) || std::isnan(magnitude) )
+            magnitude = 0.f;
+        return juce::Decibels::gainToDecibels(magnitude / float(numBins), negativeInfinity);
+    }
 };
 
 template<typename PathType>
 struct AnalyzerPathGenerator
 {
     /*
-     converts 'renderData[]' into a juce::Path
+     converts 'renderData[]' into 'p', one point per pixel column, reusing
+     the path's storage. Columns that span several bins show the loudest of
+     them, columns between two bins interpolate, so the path costs the same
+     at any FFT size.
      */
     void generatePath(const std::vector<float>& renderData,
                       juce::Rectangle<float> fftBounds,
                       int fftSize,
                       float binWidth,
-                      float negativeInfinity)
+                      float negativeInfinity,
+                      PathType& p)
     {
         auto top = fftBounds.getY();
         auto bottom = fftBounds.getHeight();
-        auto width = fftBounds.getWidth();
+        auto width = (int)fftBounds.getWidth();
 
-        int numBins = (int)fftSize / 2;
+        if( width <= 0 )
+            return;
+        
+        updateColumns(width, fftSize, binWidth);
 
-        PathType p;
-        p.preallocateSpace(3 * (int)fftBounds.getWidth());
+        p.clear();
+        p.preallocateSpace(3 * width);
 
         auto map = [bottom, top, negativeInfinity](float v)
         {
@@ -123,45 +188,76 @@ struct AnalyzerPathGenerator
                               float(bottom+10),   top);
         };
 
-        auto y = map(renderData[0]);
-
-//        jassert( !std::isnan(y) && !std::isinf(y) );
-        if( std::isnan(y) || std::isinf(y) )
-            y = bottom;
-        
-        p.startNewSubPath(0, y);
-
-        const int pathResolution = 2; //you can draw line-to's every 'pathResolution' pixels.
-
-        for( int binNum = 1; binNum < numBins; binNum += pathResolution )
+        for( int x = 0; x < width; ++x )
         {
-            y = map(renderData[binNum]);
-
-//            jassert( !std::isnan(y) && !std::isinf(y) );
-
-            if( !std::isnan(y) && !std::isinf(y) )
-            {
-                auto binFreq = binNum * binWidth;
-                auto normalizedBinX = juce::mapFromLog10(binFreq, 20.f, 20000.f);
-                int binX = std::floor(normalizedBinX * width);
-                p.lineTo(binX, y);
-            }
+            const auto& column = columns[(size_t)x];
+            const auto* bins = renderData.data() + column.firstBin;
+            const auto level = column.numBins > 0
+                             ? juce::FloatVectorOperations::findMaximum(bins, column.numBins)
+                             : bins[0] + column.fraction * (bins[1] - bins[0]);
+            
+            auto y = map(level);
+            if( std::isnan(y) || std::isinf(y) )
+                y = bottom;
+            
+            if( x == 0 )
+                p.startNewSubPath(0, y);
+            else
+                p.lineTo(x, y);
         }
-
-        pathFifo.push(p);
     }
-
-    int getNumPathsAvailable() const
+private:
+    /**
+     the bins that land in one pixel column: 'numBins' of them from
+     'firstBin', or none, and then the column sits 'fraction' of the way
+     from 'firstBin' to the next one.
+     */
+    struct ColumnBins
     {
-        return pathFifo.getNumAvailableForReading();
-    }
-
-    bool getPath(PathType& path)
+        int firstBin = 1;
+        int numBins = 0;
+        float fraction = 0.f;
+    };
+    
+    std::vector<ColumnBins> columns;
+    int columnsFFTSize = 0;
+    float columnsBinWidth = 0.f;
+    
+    /** rebuilds the bin to column table when the width, FFT size or sample rate changed. */
+    void updateColumns(int width, int fftSize, float binWidth)
     {
-        return pathFifo.pull(path);
+        if( (int)columns.size() == width && columnsFFTSize == fftSize && columnsBinWidth == binWidth )
+            return;
+        
+        columns.resize((size_t)width);
+        columnsFFTSize = fftSize;
+        columnsBinWidth = binWidth;
+        
+        // DC is left out, the last usable bin is just below Nyquist
+        const auto lastBin = fftSize / 2 - 1;
+        auto getFrequency = [width](float x) { return juce::mapToLog10(x / float(width), 20.f, 20000.f); };
+        
+        for( int x = 0; x < width; ++x )
+        {
+            auto& column = columns[(size_t)x];
+            const auto firstBin = juce::jlimit(1, lastBin + 1, (int)std::ceil(getFrequency(float(x)) / binWidth));
+            const auto endBin = juce::jlimit(1, lastBin + 1, (int)std::ceil(getFrequency(float(x + 1)) / binWidth));
+            
+            if( endBin > firstBin )
+            {
+                column.firstBin = firstBin;
+                column.numBins = endBin - firstBin;
+                column.fraction = 0.f;
+            }
+            else
+            {
+                const auto position = juce::jlimit(1.f, float(lastBin), getFrequency(x + 0.5f) / binWidth);
+                column.firstBin = juce::jmin((int)position, lastBin - 1);
+                column.numBins = 0;
+                column.fraction = position - float(column.firstBin);
+            }
+        }
     }
-private:
-    Fifo<PathType> pathFifo;
 };
 
 struct LookAndFeel : juce::LookAndFeel_V4
@@ -206,22 +302,140 @@ private:
 
 struct PathProducer
 {
-    PathProducer(SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>& scsf) :
+    PathProducer(SingleChannelSampleFifo& scsf) :
         leftChannelFifo(&scsf)
     {
-        leftChannelFFTDataGenerator.changeOrder(FFTOrder::order2048);
-        monoBuffer.setSize(1, leftChannelFFTDataGenerator.getFFTSize());
+        // whatever piled up while no editor was reading is long out of date
+        leftChannelFifo->skipSamples(leftChannelFifo->getNumSamplesAvailable());
+
+        // room for the largest order, so a new resolution has a full window straight away
+        monoBuffer.setSize(1, AnalyzerFFTPlans::maxFFTSize);
     }
-    void process(juce::Rectangle<float> fftBounds, double sampleRate);
-    juce::Path getPath() { return leftChannelFFTPath; }
+    /**
+     drains the FIFO into the window. Returns true once at least 'hopSize'
+     new samples came in since the last path, frames the display can't keep
+     up with are never transformed, so the cost depends on the display rate,
+     not the host's buffer size.
+     */
+    bool pullSamples(int hopSize);
+    
+    /** the newest AnalyzerFFTPlans::maxFFTSize samples. */
+    const juce::AudioBuffer<float>& getWindow() const { return monoBuffer; }
+    
+    /** turns one frame of FFT data, made from getWindow(), into the path. */
+    void generatePath(const std::vector<float>& fftData, juce::Rectangle<float> fftBounds, int fftSize, double sampleRate);
+    const juce::Path& getPath() const { return leftChannelFFTPath; }
+    
+    /** hands the path over without copying it, 'other' comes back to be built into next time. */
+    void swapPath(juce::Path& other) { leftChannelFFTPath.swapWithPath(other); }
 private:
-    SingleChannelSampleFifo<SimpleEQAudioProcessor::BlockType>* leftChannelFifo;
+    SingleChannelSampleFifo* leftChannelFifo;
     juce::AudioBuffer<float> monoBuffer;
-    FFTDataGenerator<std::vector<float>> leftChannelFFTDataGenerator;
+    int samplesSinceLastFrame = 0;
     AnalyzerPathGenerator<juce::Path> pathProducer;
     juce::Path leftChannelFFTPath;
 };
 
+/**
+ Drains the analyzer FIFOs, runs the FFTs, builds the paths and strokes them
+ into an image on its own thread, at the display rate. Finished frames go to
+ the message thread through a TripleBuffer, so painting only draws an image,
+ never waits for the analysis, and a busy message thread never holds the
+ analysis up.
+ */
+struct AnalyzerThread : juce::Thread
+{
+    /** where the analyzer goes in the component, and the display scale to draw it at. */
+    struct Layout
+    {
+        juce::Rectangle<int> renderArea, analysisArea;
+        float scale = 1.f;
+        
+        bool operator==(const Layout& other) const
+        {
+            return renderArea == other.renderArea && analysisArea == other.analysisArea && scale == other.scale;
+        }
+        bool operator!=(const Layout& other) const { return !(*this == other); }
+    };
+    
+    struct Snapshot
+    {
+        juce::Path left, right;
+        Layout layout;
+        
+        /** both paths over the render area, at the layout's scale. */
+        juce::Image image;
+    };
+    
+    AnalyzerThread(SimpleEQAudioProcessor& p);
+    ~AnalyzerThread() override;
+    
+    /** set from the message thread. */
+    void setLayout(const Layout& newLayout);
+    
+    /** message thread: the newest frame, or nullptr when nothing changed since the last call. */
+    const Snapshot* getNewSnapshot() noexcept { return snapshots.getNewestBuffer(); }
+    const Snapshot& getSnapshot() const noexcept { return snapshots.getReadBuffer(); }
+    
+    void run() override;
+private:
+    SimpleEQAudioProcessor& audioProcessor;
+    PathProducer leftPathProducer, rightPathProducer;
+    StereoFFTDataGenerator fftDataGenerator;
+    juce::SpinLock layoutLock;
+    Layout layout;
+    TripleBuffer<Snapshot> snapshots;
+    
+    static void renderImage(Snapshot& snapshot);
+    
+    // the buffer published last can't come back as the write buffer before the
+    // next publish, so the thread can compare with it without a copy of its own
+    const Snapshot* lastPublished = nullptr;
+};
+
+/**
+ The grid behind the response curve, rendered once per size and display
+ scale and shared through a juce::SharedResourcePointer by every open editor,
+ so opening an editor or flipping between instances mostly finds its
+ background already drawn. Message thread only.
+ */
+struct ResponseGridImageCache
+{
+    static constexpr size_t defaultCapacity = 8;
+    
+    /** the cached image, or the one 'render(juce::Graphics&)' draws at 'scale' when there is none yet. */
+    template<typename Renderer>
+    juce::Image getImage(int width, int height, float scale, Renderer&& render)
+    {
+        JUCE_ASSERT_MESSAGE_THREAD
+        
+        const auto key = makeKey(width, height, scale);
+        juce::Image image;
+        if (images.get(key, image))
+            return image;
+        
+        image = juce::Image(juce::Image::PixelFormat::RGB,
+                            juce::roundToInt(width * scale),
+                            juce::roundToInt(height * scale),
+                            true);
+        juce::Graphics g(image);
+        g.addTransform(juce::AffineTransform::scale(scale));
+        render(g);
+        
+        images.put(key, image);
+        return image;
+    }
+private:
+    static juce::uint64 makeKey(int width, int height, float scale) noexcept
+    {
+        return (juce::uint64(juce::uint32(width)) << 40)
+             | (juce::uint64(juce::uint32(height)) << 16)
+             | juce::uint64(juce::roundToInt(scale * 100.f) & 0xffff);
+    }
+    
+    LRUCache<juce::uint64, juce::Image> images { defaultCapacity };
+};
+
 struct ResponseCurveComponent :
 juce::Component,
 juce::AudioProcessorParameter::Listener,
@@ -234,15 +448,93 @@ juce::Timer
     void timerCallback() override;
     void paint(juce::Graphics& g) override;
     void resized() override;
+    void visibilityChanged() override { updateDisplayResources(); }
+    void parentHierarchyChanged() override { updateDisplayResources(); }
 private:
     SimpleEQAudioProcessor& audioProcessor;
     juce::Atomic<bool> parametersChanged { false };
-    MonoChain monoChain;
+    CoefficientSet responseCoefficients;
+    double designSampleRate = 44100.0;
     void updateChain();
+    
+    // the magnitude of each stage per pixel column, only recomputed when its
+    // settings, the sample rate or the size change, and the finished curve
+    enum ResponseStage { LowCutStage, PeakStage, HighCutStage, numResponseStages };
+    MagnitudeResponse magnitudeResponse;
+    std::array<MagnitudeResponse::Curve, numResponseStages> stageCurves;
+    std::array<bool, numResponseStages> stageNeedsUpdate { true, true, true };
+    juce::Path responseCurve;
+    void updateResponseCurve();
+    
+    // the frame and the response curve, drawn again only when the curve or the
+    // display scale changes, so a frame is just three image draws
+    juce::Image overlay;
+    void updateOverlay();
+    
+    // the timer runs at the frame rate cap while something changes and slows
+    // down to idleFrameRate once nothing has for a while
+    static constexpr int idleFrameRate = 10;
+    int idleTicks = 0;
+    void setFrameRate(int framesPerSecond);
+    
+    // the grid comes from the shared cache, fetched once the component is
+    // showing, and again after a resize or a move to a display with another scale
+    juce::SharedResourcePointer<ResponseGridImageCache> gridImages;
     juce::Image background;
+    float backgroundScale = 0.f;
+    void updateBackground();
+    void drawGrid(juce::Graphics& g);
+    
     juce::Rectangle<int> getRenderArea();
     juce::Rectangle<int> getAnalysisArea();
-    PathProducer leftPathProducer, rightPathProducer;
+    
+    // made the first time the component is showing, an editor that is never
+    // shown doesn't analyse
+    std::unique_ptr<AnalyzerThread> analyzerThread;
+    
+    /**
+     starts the analyzer and fetches the grid once the component is on
+     screen, so paint() only ever draws. Returns true when the grid changed.
+     */
+    bool updateDisplayResources();
+};
+
+#if SIMPLEEQ_REALTIME_MONITOR
+/**
+ one line of audio thread stats under the response curve. Click to start counting again.
+ */
+struct RealtimeStatsComponent : juce::Component, juce::Timer
+{
+    RealtimeStatsComponent(SimpleEQAudioProcessor& p) : audioProcessor(p) { startTimerHz(4); }
+    void timerCallback() override;
+    void paint(juce::Graphics& g) override;
+    void mouseDown(const juce::MouseEvent&) override { audioProcessor.resetRealtimeStats(); }
+private:
+    SimpleEQAudioProcessor& audioProcessor;
+    RealtimeMonitor::Stats stats;
+};
+#endif
+
+/**
+ a row of drop-downs for the AnalyzerSettings. Those aren't parameters, so
+ there are no attachments. The boxes follow the settings when the host
+ restores a state.
+ */
+struct AnalyzerControlsComponent :
+juce::Component,
+juce::ValueTree::Listener,
+juce::AsyncUpdater
+{
+    AnalyzerControlsComponent(SimpleEQAudioProcessor&);
+    ~AnalyzerControlsComponent() override;
+    void resized() override;
+    void valueTreePropertyChanged(juce::ValueTree& tree, const juce::Identifier& property) override;
+    void valueTreeRedirected(juce::ValueTree& tree) override { triggerAsyncUpdate(); }
+    void handleAsyncUpdate() override;
+private:
+    SimpleEQAudioProcessor& audioProcessor;
+    std::array<juce::Label, AnalyzerSettings::numSettings> labels;
+    std::array<juce::ComboBox, AnalyzerSettings::numSettings> boxes;
 };
 
 //==============================================================================
@@ -269,6 +561,10 @@ private:
         highCutSlopeSlider;
     
     ResponseCurveComponent responseCurveComponent;
+    AnalyzerControlsComponent analyzerControlsComponent { audioProcessor };
+#if SIMPLEEQ_REALTIME_MONITOR
+    RealtimeStatsComponent realtimeStatsComponent { audioProcessor };
+#endif
     
     using Attachment = juce::AudioProcessorValueTreeState::SliderAttachment;
     
@@ -22,6 +22,9 @@ SimpleEQAudioProcessor::SimpleEQAudioProcessor()
                        )
 #endif
 {
+    // picks up what the audio thread flagged for the message thread. Waking
+    // the message thread from the audio thread would take a lock
+    startTimerHz(10);
 }
 
 SimpleEQAudioProcessor::~SimpleEQAudioProcessor()
@@ -63,7 +66,10 @@ bool SimpleEQAudioProcessor::isMidiEffect() const
 
 double SimpleEQAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    // the oversampling filters and the linear phase FIR hold back as many
+    // samples as they delay
+    auto sampleRate = getSampleRate();
+    return sampleRate > 0.0 ? latencyToReport.load() / sampleRate : 0.0;
 }
 
 int SimpleEQAudioProcessor::getNumPrograms()
@@ -98,18 +104,44 @@ void SimpleEQAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlo
     
     juce::dsp::ProcessSpec spec;
     spec.maximumBlockSize = samplesPerBlock;
-    spec.numChannels = 1;
+    spec.numChannels = getTotalNumOutputChannels();
     spec.sampleRate = sampleRate;
-    leftChain.prepare(spec);
-    rightChain.prepare(spec);
     
-    updateFilters();
+    for (int order = 1; order < numOversamplingOrders; ++order)
+    {
+        // polyphase half-band IIR stages, max quality, rounded to a whole number of samples of latency
+        oversamplers[order] = std::make_unique<juce::dsp::Oversampling<float>>(spec.numChannels, order, juce::dsp::Oversampling<float>::filterHalfBandPolyphaseIIR, true, true);
+        oversamplers[order]->initProcessing(samplesPerBlock);
+        doublePrecisionOversamplers[order] = std::make_unique<juce::dsp::Oversampling<double>>(spec.numChannels, order, juce::dsp::Oversampling<double>::filterHalfBandPolyphaseIIR, true, true);
+        doublePrecisionOversamplers[order]->initProcessing(samplesPerBlock);
+        oversamplingLatencies[order] = juce::roundToInt(oversamplers[order]->getLatencyInSamples());
+    }
+    
+    // the engines may see blocks at up to 8x the host block size
+    auto filterSpec = spec;
+    filterSpec.maximumBlockSize = samplesPerBlock << (numOversamplingOrders - 1);
+    filterEngine.prepare(filterSpec);
+    doublePrecisionFilterEngine.prepare(filterSpec);
+    linearPhaseEngine.prepare(sampleRate, (int) spec.numChannels);
+    realtimeMonitor.prepare(sampleRate);
+    realtimeMonitor.reset();
+    
+    coefficientDesigner.prepare(sampleRate);
+    if (auto* coefficientSet = coefficientDesigner.getNewCoefficients())
+    {
+        updateFilters(*coefficientSet);
+    }
+    setOversamplingOrder(oversamplingOrder);
+    
+    usingLinearPhase = linearPhase->load() > 0.5f && linearPhaseEngine.hasKernel();
+    latencyToReport.store(getLatencyForMode(usingLinearPhase));
+    setLatencySamples(latencyToReport.load());
     
     leftChannelFifo.prepare(samplesPerBlock);
     rightChannelFifo.prepare(samplesPerBlock);
+    preparedSampleRate.store(sampleRate, std::memory_order_release);
     
     osc.initialise([](float x) { return std::sin(x); });
-    spec.numChannels = getTotalNumOutputChannels();
     osc.prepare(spec);
     osc.setFrequency(80);
 }
@@ -118,6 +150,12 @@ void SimpleEQAudioProcessor::releaseResources()
 {
     // When playback stops, you can use this as an opportunity to free up any
     // spare memory, etc.
+    
+    // the audio thread is gone, it can't acknowledge a stopping tap any more.
+    // The host may call this from any thread, and the client registry lives
+    // on the message thread, so the FIFOs are freed there by timerCallback()
+    auto stopping = static_cast<int>(analyzerTapStopping);
+    analyzerTapState.compare_exchange_strong(stopping, analyzerTapOff);
 }
 
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -127,12 +165,9 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
     juce::ignoreUnused (layouts);
     return true;
   #else
-    // This is the place where you check if the layout is supported.
-    // In this template code we only support mono or stereo.
-    // Some plugin hosts, such as certain GarageBand versions, will only
-    // load plugins that support stereo bus layouts.
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::mono()
-     && layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+    // Any layout works, from mono to surround and ambisonic beds: the
+    // FilterEngine packs however many channels there are into SIMD lanes.
+    if (layouts.getMainOutputChannelSet().isDisabled())
         return false;
 
     // This checks if the input layout matches the output layout
@@ -147,6 +182,19 @@ bool SimpleEQAudioProcessor::isBusesLayoutSupported (const BusesLayout& layouts)
 #endif
 
 void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+{
+    RealtimeMonitor::ScopedBlock monitoredBlock(realtimeMonitor, buffer.getNumSamples());
+    processSamples(buffer);
+}
+
+void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<double>& buffer, juce::MidiBuffer& midiMessages)
+{
+    RealtimeMonitor::ScopedBlock monitoredBlock(realtimeMonitor, buffer.getNumSamples());
+    processSamples(buffer);
+}
+
+template<typename SampleType>
+void SimpleEQAudioProcessor::processSamples (juce::AudioBuffer<SampleType>& buffer)
 {
     juce::ScopedNoDenormals noDenormals;
     auto totalNumInputChannels  = getTotalNumInputChannels();
@@ -161,23 +209,82 @@ void SimpleEQAudioProcessor::processBlock (juce::AudioBuffer<float>& buffer, juc
     for (auto i = totalNumInputChannels; i < totalNumOutputChannels; ++i)
         buffer.clear (i, 0, buffer.getNumSamples());
 
-    updateFilters();
+    if (auto* coefficientSet = coefficientDesigner.getNewCoefficients())
+    {
+        updateFilters(*coefficientSet);
+    }
     
-    juce::dsp::AudioBlock<float> block(buffer);
+    juce::dsp::AudioBlock<SampleType> block(buffer);
     
     // debug spectrum analyzer code
 //    buffer.clear();
 //    juce::dsp::ProcessContextReplacing<float> stereoContext(block);
 //    osc.process(stereoContext);
     
-    auto leftBlock = block.getSingleChannelBlock(0);
-    auto rightBlock = block.getSingleChannelBlock(1);
-    juce::dsp::ProcessContextReplacing<float> leftContext(leftBlock);
-    juce::dsp::ProcessContextReplacing<float> rightContext(rightBlock);
-    leftChain.process(leftContext);
-    rightChain.process(rightContext);
-    leftChannelFifo.update(buffer);
-    rightChannelFifo.update(buffer);
+    // the IIR cascade keeps running until the first FIR has been built
+    const bool useLinearPhase = linearPhase->load() > 0.5f && linearPhaseEngine.hasKernel();
+    if (useLinearPhase != usingLinearPhase)
+    {
+        // the path taking over hasn't seen the recent samples
+        linearPhaseEngine.reset();
+        filterEngine.reset();
+        doublePrecisionFilterEngine.reset();
+        usingLinearPhase = useLinearPhase;
+    }
+    setLatencyToReport(getLatencyForMode(useLinearPhase));
+    
+    // double I/O always runs with double state, float I/O only when asked to,
+    // e.g. for steep low cuts at high sample rates
+    const bool useDoublePrecision = std::is_same_v<SampleType, double> || highPrecision->load() > 0.5f;
+    if (useDoublePrecision != usingDoublePrecision)
+    {
+        // the engine taking over hasn't seen the recent samples
+        if (useDoublePrecision)
+            doublePrecisionFilterEngine.reset();
+        else
+            filterEngine.reset();
+        usingDoublePrecision = useDoublePrecision;
+    }
+    
+    // channels run through the cascade in groups, one channel per SIMD lane
+    auto processFilters = [this, useDoublePrecision](juce::dsp::AudioBlock<SampleType>& filterBlock)
+    {
+        if (useDoublePrecision)
+            doublePrecisionFilterEngine.process(filterBlock);
+        else
+            filterEngine.process(filterBlock);
+    };
+    
+    if (useLinearPhase)
+    {
+        linearPhaseEngine.process(block);
+    }
+    else if (oversamplingOrder == 0)
+    {
+        processFilters(block);
+    }
+    else
+    {
+        auto& oversampler = getOversampler<SampleType>(oversamplingOrder);
+        auto oversampledBlock = oversampler.processSamplesUp(block);
+        processFilters(oversampledBlock);
+        oversampler.processSamplesDown(block);
+    }
+    
+    // a single check while no analyzer is open
+    const auto tapState = analyzerTapState.load(std::memory_order_acquire);
+    if (tapState == analyzerTapRunning)
+    {
+        leftChannelFifo.update(buffer);
+        rightChannelFifo.update(buffer);
+    }
+    else if (tapState == analyzerTapStopping)
+    {
+        // this thread won't touch the FIFOs again, their memory can go once
+        // timerCallback() sees the tap off
+        auto stopping = static_cast<int>(analyzerTapStopping);
+        analyzerTapState.compare_exchange_strong(stopping, analyzerTapOff, std::memory_order_acq_rel);
+    }
 }
 
 //==============================================================================
@@ -209,7 +316,8 @@ void SimpleEQAudioProcessor::setStateInformation (const void* data, int sizeInBy
     if ( tree.isValid() )
     {
         apvts.replaceState(tree);
-        updateFilters();
+        analyzerSettings.load(apvts.state);
+        coefficientDesigner.requestUpdate();
     }
 }
 
@@ -223,62 +331,422 @@ ChainSettings getChainSettings(juce::AudioProcessorValueTreeState& apvts)
     settings.peakFreq = apvts.getRawParameterValue("Peak Freq")->load();
     settings.peakGainInDecibels = apvts.getRawParameterValue("Peak Gain")->load();
     settings.peakQuality = apvts.getRawParameterValue("Peak Quality")->load();
+    settings.oversamplingOrder = static_cast<int>(apvts.getRawParameterValue("Oversampling")->load());
     return settings;
 }
 
-Coefficients makePeakFilter(const ChainSettings& chainSettings, double sampleRate)
+void updateCoefficients(Coefficients& old, const BiquadCoeffs& replacement)
+{
+    // a biquad is stored as b0, b1, b2, a1, a2. Only a filter that still holds
+    // its default first order coefficients gets reallocated, which happens in
+    // prepareToPlay, after that this is a plain copy
+    if (old->coefficients.size() != 5)
+    {
+        *old = juce::dsp::IIR::Coefficients<float>(1, 0, 0, 1, 0, 0);
+    }
+    
+    auto* raw = old->getRawCoefficients();
+    raw[0] = (float) replacement.b0;
+    raw[1] = (float) replacement.b1;
+    raw[2] = (float) replacement.b2;
+    raw[3] = (float) replacement.a1;
+    raw[4] = (float) replacement.a2;
+}
+
+CoefficientSet makeCoefficientSet(const ChainSettings& chainSettings, double sampleRate, CoefficientCache& cache)
+{
+    CoefficientSet coefficientSet;
+    coefficientSet.chainSettings = chainSettings;
+    coefficientSet.peak = cache.getPeakFilter(chainSettings, sampleRate);
+    coefficientSet.lowCut = cache.getLowCutFilter(chainSettings, sampleRate);
+    coefficientSet.highCut = cache.getHighCutFilter(chainSettings, sampleRate);
+    return coefficientSet;
+}
+
+//==============================================================================
+namespace
+{
+    // keys are quantized finer than the parameter steps, so settings that
+    // differ only by float noise share one entry
+    juce::int64 quantize(double value, double step)
+    {
+        return (juce::int64) std::llround(value / step);
+    }
+    
+    constexpr double frequencyStep = 0.01;
+    constexpr double qualityStep = 0.001;
+    constexpr double gainStep = 0.01;
+    constexpr double sampleRateStep = 0.01;
+}
+
+bool CoefficientCache::Key::operator==(const Key& other) const
+{
+    return type == other.type
+        && slope == other.slope
+        && frequency == other.frequency
+        && quality == other.quality
+        && gain == other.gain
+        && sampleRate == other.sampleRate;
+}
+
+size_t CoefficientCache::KeyHash::operator()(const Key& key) const noexcept
+{
+    std::hash<juce::int64> hasher;
+    size_t hash = hasher((juce::int64) key.type);
+    for (auto value : { (juce::int64) key.slope, key.frequency, key.quality, key.gain, key.sampleRate })
+    {
+        hash = hash * 31 + hasher(value);
+    }
+    return hash;
+}
+
+template<typename DesignFunction>
+CutCoefficients CoefficientCache::getOrDesign(const Key& key, DesignFunction&& design)
+{
+    const juce::ScopedLock sl(lock);
+    
+    CutCoefficients coefficients {};
+    if (cache.get(key, coefficients))
+    {
+        ++hits;
+        return coefficients;
+    }
+    
+    ++misses;
+    coefficients = design(key.frequency * frequencyStep, key.sampleRate * sampleRateStep);
+    cache.put(key, coefficients);
+    return coefficients;
+}
+
+BiquadCoeffs CoefficientCache::getPeakFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    Key key { FilterType::Peak,
+              0,
+              quantize(chainSettings.peakFreq, frequencyStep),
+              quantize(chainSettings.peakQuality, qualityStep),
+              quantize(chainSettings.peakGainInDecibels, gainStep),
+              quantize(sampleRate, sampleRateStep) };
+    
+    auto coefficients = getOrDesign(key, [&key](double frequency, double rate)
+    {
+        ChainSettings quantized;
+        quantized.peakFreq = (float) frequency;
+        quantized.peakQuality = (float) (key.quality * qualityStep);
+        quantized.peakGainInDecibels = (float) (key.gain * gainStep);
+        
+        CutCoefficients designed {};
+        designed[0] = makePeakFilter(quantized, rate);
+        return designed;
+    });
+    
+    return coefficients[0];
+}
+
+CutCoefficients CoefficientCache::getLowCutFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    Key key { FilterType::LowCut,
+              chainSettings.lowCutSlope,
+              quantize(chainSettings.lowCutFreq, frequencyStep),
+              0,
+              0,
+              quantize(sampleRate, sampleRateStep) };
+    
+    return getOrDesign(key, [&chainSettings](double frequency, double rate)
+    {
+        auto quantized = chainSettings;
+        quantized.lowCutFreq = (float) frequency;
+        
+        CutCoefficients designed {};
+        makeLowCutFilter(quantized, rate, designed);
+        return designed;
+    });
+}
+
+CutCoefficients CoefficientCache::getHighCutFilter(const ChainSettings& chainSettings, double sampleRate)
+{
+    Key key { FilterType::HighCut,
+              chainSettings.highCutSlope,
+              quantize(chainSettings.highCutFreq, frequencyStep),
+              0,
+              0,
+              quantize(sampleRate, sampleRateStep) };
+    
+    return getOrDesign(key, [&chainSettings](double frequency, double rate)
+    {
+        auto quantized = chainSettings;
+        quantized.highCutFreq = (float) frequency;
+        
+        CutCoefficients designed {};
+        makeHighCutFilter(quantized, rate, designed);
+        return designed;
+    });
+}
+
+void CoefficientCache::setCapacity(size_t maxEntries)
+{
+    const juce::ScopedLock sl(lock);
+    cache.setCapacity(maxEntries);
+}
+
+CoefficientCache::Stats CoefficientCache::getStats() const
+{
+    const juce::ScopedLock sl(lock);
+    
+    Stats stats;
+    stats.hits = hits.load();
+    stats.misses = misses.load();
+    stats.size = cache.size();
+    stats.capacity = cache.getCapacity();
+    return stats;
+}
+
+void SimpleEQAudioProcessor::updateFilters(const CoefficientSet& coefficientSet)
+{
+    // a set is designed for one oversampling factor, so switch along with it
+    if (coefficientSet.chainSettings.oversamplingOrder != oversamplingOrder)
+    {
+        setOversamplingOrder(coefficientSet.chainSettings.oversamplingOrder);
+    }
+    
+    filterEngine.setCoefficients(coefficientSet);
+    doublePrecisionFilterEngine.setCoefficients(coefficientSet);
+}
+
+template<typename SampleType>
+juce::dsp::Oversampling<SampleType>& SimpleEQAudioProcessor::getOversampler(int order)
+{
+    if constexpr (std::is_same_v<SampleType, double>)
+        return *doublePrecisionOversamplers[order];
+    else
+        return *oversamplers[order];
+}
+
+void SimpleEQAudioProcessor::setOversamplingOrder(int order)
+{
+    oversamplingOrder = juce::jlimit(0, numOversamplingOrders - 1, order);
+    
+    // the filter state belongs to the old rate
+    filterEngine.reset();
+    doublePrecisionFilterEngine.reset();
+    if (oversamplingOrder > 0)
+    {
+        oversamplers[oversamplingOrder]->reset();
+        doublePrecisionOversamplers[oversamplingOrder]->reset();
+    }
+}
+
+int SimpleEQAudioProcessor::getLatencyForMode(bool useLinearPhase) const
 {
-    return juce::dsp::IIR::Coefficients<float>::makePeakFilter(sampleRate,
-                                                               chainSettings.peakFreq,
-                                                               chainSettings.peakQuality,
-                                                               juce::Decibels::decibelsToGain(chainSettings.peakGainInDecibels));
+    return useLinearPhase ? linearPhaseEngine.getLatencyInSamples() : oversamplingLatencies[oversamplingOrder];
 }
 
-void updateCoefficients(Coefficients& old, const Coefficients& replacements)
+void SimpleEQAudioProcessor::setLatencyToReport(int latencyInSamples)
 {
-    *old = *replacements;
+    // the host is told on the message thread, by timerCallback()
+    if (latencyToReport.exchange(latencyInSamples) != latencyInSamples)
+    {
+        latencyChanged.store(true, std::memory_order_release);
+    }
 }
 
-void SimpleEQAudioProcessor::updatePeakFilter(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::timerCallback()
 {
-    auto peakCoefficients = makePeakFilter(chainSettings, getSampleRate());
-    updateCoefficients(leftChain.get<ChainPositions::Peak>().coefficients,  peakCoefficients);
-    updateCoefficients(rightChain.get<ChainPositions::Peak>().coefficients,  peakCoefficients);
+    if (latencyChanged.exchange(false, std::memory_order_acq_rel))
+        setLatencySamples(latencyToReport.load());
+    
+    releaseAnalyzerBuffersIfUnused();
 }
 
-void SimpleEQAudioProcessor::updateLowCutFilters(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::addAnalyzerClient()
 {
-    auto cutCoefficients = makeLowCutFilter(chainSettings, getSampleRate());
-    auto& leftChainLowCut = leftChain.get<ChainPositions::LowCut>();
-    updateCutFilter(leftChainLowCut,
-                    cutCoefficients,
-                    chainSettings.lowCutSlope);
-    auto& rightChainLowCut = rightChain.get<ChainPositions::LowCut>();
-    updateCutFilter(rightChainLowCut,
-                    cutCoefficients,
-                    chainSettings.lowCutSlope);
+    JUCE_ASSERT_MESSAGE_THREAD
+    
+    // a second client would be a second consumer of the single-consumer rings
+    jassert(numAnalyzerClients == 0);
+    if (numAnalyzerClients++ > 0)
+        return;
+    
+    // the audio thread hasn't let go of the FIFOs yet, so they still have their memory
+    auto stopping = static_cast<int>(analyzerTapStopping);
+    if (analyzerTapState.compare_exchange_strong(stopping, analyzerTapRunning, std::memory_order_acq_rel))
+        return;
+    
+    // off and no reader yet, so this is the one time the rings can be sized
+    // for the current block size. The audio thread keeps away until it sees
+    // the tap running
+    leftChannelFifo.allocate();
+    rightChannelFifo.allocate();
+    analyzerTapState.store(analyzerTapRunning, std::memory_order_release);
 }
 
-void SimpleEQAudioProcessor::updateHighCutFilters(const ChainSettings& chainSettings)
+void SimpleEQAudioProcessor::removeAnalyzerClient()
 {
-    auto highCutCoefficients = makeHighCutFilter(chainSettings, getSampleRate());
-    auto& leftChainHighCut = leftChain.get<ChainPositions::HighCut>();
-    updateCutFilter(leftChainHighCut,
-                    highCutCoefficients,
-                    chainSettings.highCutSlope);
-    auto& rightChainHighCut = rightChain.get<ChainPositions::HighCut>();
-    updateCutFilter(rightChainHighCut,
-                    highCutCoefficients,
-                    chainSettings.highCutSlope);
+    JUCE_ASSERT_MESSAGE_THREAD
+    jassert(numAnalyzerClients > 0);
     
+    if (--numAnalyzerClients == 0)
+        analyzerTapState.store(analyzerTapStopping, std::memory_order_release);
+}
+
+void SimpleEQAudioProcessor::releaseAnalyzerBuffersIfUnused()
+{
+    JUCE_ASSERT_MESSAGE_THREAD
+    
+    if (numAnalyzerClients == 0 && analyzerTapState.load() == analyzerTapOff
+        && (leftChannelFifo.isAllocated() || rightChannelFifo.isAllocated()))
+    {
+        leftChannelFifo.release();
+        rightChannelFifo.release();
+    }
+}
+
+//==============================================================================
+namespace
+{
+    struct AnalyzerSettingInfo
+    {
+        const char* name;
+        const char* propertyID;
+        juce::StringArray choices;
+        int defaultChoice;
+    };
+    
+    const AnalyzerSettingInfo& getAnalyzerSettingInfo(AnalyzerSettings::Setting setting)
+    {
+        static const std::array<AnalyzerSettingInfo, AnalyzerSettings::numSettings> infos
+        {{
+            { "Resolution", "analyzerResolution", { "2048", "4096", "8192" }, 0 },
+            { "Overlap", "analyzerOverlap", { "0%", "25%", "50%", "75%" }, 2 },
+            { "Frame Rate", "maxFrameRate", { "15 Hz", "30 Hz", "60 Hz", "120 Hz" }, 2 },
+            { "Mode", "analyzerMode", { "Left/Right", "Mid/Side" }, 0 },
+        }};
+        return infos[(size_t) setting];
+    }
+}
+
+AnalyzerSettings::AnalyzerSettings()
+{
+    for (int i = 0; i < numSettings; ++i)
+    {
+        choices[(size_t) i].store(getAnalyzerSettingInfo(static_cast<Setting>(i)).defaultChoice);
+    }
+}
+
+juce::String AnalyzerSettings::getName(Setting setting)
+{
+    return getAnalyzerSettingInfo(setting).name;
+}
+
+juce::StringArray AnalyzerSettings::getChoices(Setting setting)
+{
+    return getAnalyzerSettingInfo(setting).choices;
 }
 
-void SimpleEQAudioProcessor::updateFilters()
+void AnalyzerSettings::set(juce::ValueTree& state, Setting setting, int choice)
 {
+    JUCE_ASSERT_MESSAGE_THREAD
+    
+    const auto& info = getAnalyzerSettingInfo(setting);
+    choice = juce::jlimit(0, info.choices.size() - 1, choice);
+    choices[(size_t) setting].store(choice);
+    state.setProperty(info.propertyID, choice, nullptr);
+}
+
+void AnalyzerSettings::load(const juce::ValueTree& state)
+{
+    for (int i = 0; i < numSettings; ++i)
+    {
+        const auto& info = getAnalyzerSettingInfo(static_cast<Setting>(i));
+        const auto choice = static_cast<int>(state.getProperty(info.propertyID, info.defaultChoice));
+        choices[(size_t) i].store(juce::jlimit(0, info.choices.size() - 1, choice));
+    }
+}
+
+//==============================================================================
+namespace
+{
+    // everything designAndPublish() reads, nothing else is worth a redesign
+    const char* const designParameterIDs[]
+    {
+        "LowCut Freq", "HighCut Freq", "Peak Freq", "Peak Gain", "Peak Quality",
+        "LowCut Slope", "HighCut Slope", "Oversampling", "Linear Phase", "Partition Size"
+    };
+}
+
+CoefficientDesigner::CoefficientDesigner(juce::AudioProcessorValueTreeState& state, LinearPhaseEngine& engine) :
+    juce::Thread("SimpleEQ Coefficient Designer"),
+    apvts(state),
+    linearPhaseEngine(engine)
+{
+    for (auto* parameterID : designParameterIDs)
+    {
+        jassert(apvts.getParameter(parameterID) != nullptr);
+        apvts.addParameterListener(parameterID, this);
+    }
+    
+    startThread();
+}
+
+CoefficientDesigner::~CoefficientDesigner()
+{
+    for (auto* parameterID : designParameterIDs)
+    {
+        apvts.removeParameterListener(parameterID, this);
+    }
+    
+    // wake the thread up so it sees the exit flag instead of waiting forever
+    signalThreadShouldExit();
+    notify();
+    stopThread(1000);
+}
+
+void CoefficientDesigner::prepare(double newSampleRate)
+{
+    sampleRate.store(newSampleRate);
+    designAndPublish();
+}
+
+void CoefficientDesigner::requestUpdate()
+{
+    needsUpdate.store(true);
+    notify();
+}
+
+void CoefficientDesigner::parameterChanged(const juce::String& parameterID, float newValue)
+{
+    // may be called from the audio thread when the host automates a parameter
+    requestUpdate();
+}
+
+void CoefficientDesigner::run()
+{
+    while (!threadShouldExit())
+    {
+        wait(-1);
+        
+        if (needsUpdate.exchange(false) && sampleRate.load() > 0.0)
+        {
+            designAndPublish();
+        }
+    }
+}
+
+void CoefficientDesigner::designAndPublish()
+{
+    // prepare() and the designer thread can both get here
+    const juce::ScopedLock sl(writerLock);
+    
     auto chainSettings = getChainSettings(apvts);
-    updateLowCutFilters(chainSettings);
-    updatePeakFilter(chainSettings);
-    updateHighCutFilters(chainSettings);
+    auto& coefficientSet = coefficientSets.getWriteBuffer();
+    coefficientSet = makeCoefficientSet(chainSettings, getDesignSampleRate(chainSettings, sampleRate.load()), *coefficientCache);
+    coefficientSets.publish();
+    
+    // the FIR runs at the host rate, oversampling doesn't apply to it
+    if (apvts.getRawParameterValue("Linear Phase")->load() > 0.5f)
+    {
+        auto partitionSizeIndex = static_cast<int>(apvts.getRawParameterValue("Partition Size")->load());
+        linearPhaseEngine.buildKernel(makeCoefficientSet(chainSettings, sampleRate.load(), *coefficientCache), partitionSizeIndex);
+    }
 }
 
 juce::AudioProcessorValueTreeState::ParameterLayout
@@ -314,6 +782,11 @@ juce::AudioProcessorValueTreeState::ParameterLayout
         }
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "LowCut Slope", 1 }, "LowCut Slope", stringArray, 0));
         layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "HighCut Slope", 1 }, "HighCut Slope", stringArray, 0));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "High Precision", 1 }, "High Precision", false));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "Oversampling", 1 }, "Oversampling", juce::StringArray { "1x", "2x", "4x", "8x" }, 0));
+        layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID { "Linear Phase", 1 }, "Linear Phase", false));
+        // smaller partitions cut the latency, larger ones the CPU load
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID { "Partition Size", 1 }, "Partition Size", juce::StringArray { "256", "512", "1024", "2048" }, 1));
         
         return layout;
 }
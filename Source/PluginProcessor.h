@@ -10,151 +10,122 @@
 
 #include <JuceHeader.h>
 #include <array>
-template<typename T>
-struct Fifo
-{
-    void prepare(int numChannels, int numSamples)
-    {
-        static_assert( std::is_same_v<T, juce::AudioBuffer<float>>,
-                      "prepare(numChannels, numSamples) should only be used when the Fifo is holding juce::AudioBuffer<float>");
-        for( auto& buffer : buffers)
-        {
-            buffer.setSize(numChannels,
-                           numSamples,
-                           false,   //clear everything?
-                           true,    //including the extra space?
-                           true);   //avoid reallocating if you can?
-            buffer.clear();
-        }
-    }
-    
-    void prepare(size_t numElements)
-    {
-        static_assert( std::is_same_v<T, std::vector<float>>,
-                      "prepare(numElements) should only be used when the Fifo is holding std::vector<float>");
-        for( auto& buffer : buffers )
-        {
-            buffer.clear();
-            buffer.resize(numElements, 0);
-        }
-    }
-    
-    bool push(const T& t)
-    {
-        auto write = fifo.write(1);
-        if( write.blockSize1 > 0 )
-        {
-            buffers[write.startIndex1] = t;
-            return true;
-        }
-        
-        return false;
-    }
-    
-    bool pull(T& t)
-    {
-        auto read = fifo.read(1);
-        if( read.blockSize1 > 0 )
-        {
-            t = buffers[read.startIndex1];
-            return true;
-        }
-        
-        return false;
-    }
-    
-    int getNumAvailableForReading() const
-    {
-        return fifo.getNumReady();
-    }
-private:
-    static constexpr int Capacity = 30;
-    std::array<T, Capacity> buffers;
-    juce::AbstractFifo fifo {Capacity};
-};
-
+#include "TripleBuffer.h"
+#include "LRUCache.h"
+#include "FilterDesign.h"
+#include "FilterEngine.h"
+#include "LinearPhaseEngine.h"
+#include "RealtimeMonitor.h"
+#include "SampleRingBuffer.h"
 enum Channel
 {
     Right, //effectively 0
     Left //effectively 1
 };
 
-template<typename BlockType>
+/**
+ The analyzer tap for one channel: the audio thread copies each block into a
+ SampleRingBuffer in one go, the analyzer reads the samples back in place.
+ The ring only has memory between allocate() and release(), which the
+ processor calls while neither the audio thread nor a reader uses it. A block
+ size that grows while an analyzer is open only makes the ring drop samples
+ until the next allocate().
+ */
 struct SingleChannelSampleFifo
 {
+    /** a few of the largest analyzer windows, and more than a display frame's worth at any rate. */
+    static constexpr int minimumCapacity = 1 << 15;
+    
     SingleChannelSampleFifo(Channel ch) : channelToUse(ch)
     {
         prepared.set(false);
     }
     
-    void update(const BlockType& buffer)
+    template<typename SampleType>
+    void update(const juce::AudioBuffer<SampleType>& buffer)
     {
         jassert(prepared.get());
-        jassert(buffer.getNumChannels() > channelToUse );
-        auto* channelPtr = buffer.getReadPointer(channelToUse);
+        jassert(buffer.getNumChannels() > 0);
+        // a mono bus feeds both analyzer channels from its only channel
+        auto* channelPtr = buffer.getReadPointer(juce::jmin((int)channelToUse, buffer.getNumChannels() - 1));
         
-        for( int i = 0; i < buffer.getNumSamples(); ++i )
-        {
-            pushNextSampleIntoFifo(channelPtr[i]);
-        }
+        ringBuffer.write(channelPtr, buffer.getNumSamples());
     }
 
+    /**
+     only records the host's block size, an analyzer may be reading the ring
+     right now. The ring is sized for it on the next allocate().
+     */
     void prepare(int bufferSize)
     {
-        prepared.set(false);
         size.set(bufferSize);
-        
-        bufferToFill.setSize(1,             //channel
-                             bufferSize,    //num samples
-                             false,         //keepExistingContent
-                             true,          //clear extra space
-                             true);         //avoid reallocating
-        audioBufferFifo.prepare(1, bufferSize);
-        fifoIndex = 0;
         prepared.set(true);
     }
+    
+    /**
+     sizes and empties the ring, and release() frees it. Only while neither
+     the audio thread nor a reader can be inside it, i.e. with the tap off
+     and no analysis client registered.
+     */
+    void allocate() { ringBuffer.prepare(juce::jmax(minimumCapacity, 4 * size.get())); }
+    void release() { ringBuffer.release(); }
+    bool isAllocated() const { return ringBuffer.getCapacity() > 0; }
     //==============================================================================
-    int getNumCompleteBuffersAvailable() const { return audioBufferFifo.getNumAvailableForReading(); }
+    int getNumSamplesAvailable() const { return ringBuffer.getNumReady(); }
     bool isPrepared() const { return prepared.get(); }
     int getSize() const { return size.get(); }
     //==============================================================================
-    bool getAudioBuffer(BlockType& buf) { return audioBufferFifo.pull(buf); }
+    /** hands the oldest 'numSamples' samples to 'useSpan(const float*, int)', in at most two spans. */
+    template<typename Function>
+    int readSamples(int numSamples, Function&& useSpan) { return ringBuffer.read(numSamples, std::forward<Function>(useSpan)); }
+    void skipSamples(int numSamples) { ringBuffer.skip(numSamples); }
 private:
     Channel channelToUse;
-    int fifoIndex = 0;
-    Fifo<BlockType> audioBufferFifo;
-    BlockType bufferToFill;
+    SampleRingBuffer ringBuffer;
     juce::Atomic<bool> prepared = false;
     juce::Atomic<int> size = 0;
-    
-    void pushNextSampleIntoFifo(float sample)
+};
+//==============================================================================
+/**
+ The analyzer's display settings. They are saved with the plugin state, as
+ properties of the APVTS state tree, but they aren't parameters: hosts don't
+ automate them and changing one never touches the DSP. Each one is mirrored
+ in an atomic, so the analyzer thread can read it.
+ */
+class AnalyzerSettings
+{
+public:
+    enum Setting
     {
-        if (fifoIndex == bufferToFill.getNumSamples())
-        {
-            auto ok = audioBufferFifo.push(bufferToFill);
-
-            juce::ignoreUnused(ok);
-            
-            fifoIndex = 0;
-        }
-        
-        bufferToFill.setSample(0, fifoIndex, sample);
-        ++fifoIndex;
-    }
+        Resolution,     // the FFT size, finer in frequency but slower to react as it grows
+        Overlap,        // how far consecutive frames overlap, smoother but busier with more
+        MaxFrameRate,   // the editor repaints and the analyzer run at most this often
+        Mode,           // the two traces show either left and right or mid and side
+        numSettings
+    };
+    
+    AnalyzerSettings();
+    
+    static juce::String getName(Setting setting);
+    static juce::StringArray getChoices(Setting setting);
+    
+    /** the index of the selected choice, safe from any thread. */
+    int get(Setting setting) const noexcept { return choices[(size_t) setting].load(std::memory_order_relaxed); }
+    
+    /** selects a choice and stores it in 'state'. Message thread only. */
+    void set(juce::ValueTree &state, Setting setting, int choice);
+    
+    /** takes the settings from a restored 'state', the ones it doesn't have go back to their defaults. */
+    void load(const juce::ValueTree &state);
+private:
+    std::array<std::atomic<int>, numSettings> choices;
 };
+
 using Filter = juce::dsp::IIR::Filter<float>;
 using CutFilter = juce::dsp::ProcessorChain<Filter, Filter, Filter, Filter>;
 using MonoChain = juce::dsp::ProcessorChain<CutFilter, Filter, CutFilter>;
 using Coefficients = Filter::CoefficientsPtr;
 
-enum Slope
-{
-    Slope_12,
-    Slope_24,
-    Slope_36,
-    Slope_48
-};
-
 enum ChainPositions
 {
     LowCut,
@@ -162,24 +133,12 @@ enum ChainPositions
     HighCut
 };
 
-struct ChainSettings
-{
-    float peakFreq{0};
-    float peakGainInDecibels{0};
-    float peakQuality{1.f};
-    float lowCutFreq{0};
-    float highCutFreq{0};
-    Slope lowCutSlope{Slope::Slope_12};
-    Slope highCutSlope{Slope::Slope_12};
-};
-
 ChainSettings getChainSettings(juce::AudioProcessorValueTreeState &apvts);
-Coefficients makePeakFilter(const ChainSettings &chainSettings, double sampleRate);
-void updateCoefficients(Coefficients &old, const Coefficients &replacements);
+void updateCoefficients(Coefficients &old, const BiquadCoeffs &replacement);
 
 template <typename ChainType, typename CoefficientType>
 void updateCutFilter(ChainType &chain,
-                     CoefficientType &coefficients,
+                     const CoefficientType &coefficients,
                      const Slope &slope)
 {
     chain.template setBypassed<0>(true);
@@ -212,19 +171,103 @@ void updateCutFilter(ChainType &chain,
     }
 }
 
-inline auto makeLowCutFilter(const ChainSettings &chainSettings, double sampleRate)
+//==============================================================================
+/**
+ Process-wide cache of designed filters, shared by every plugin instance through
+ a juce::SharedResourcePointer. Instances running at the same sample rate with
+ the same settings get the already designed coefficients instead of running the
+ Butterworth design again. Only used from the designer threads, never from the
+ audio thread.
+ */
+class CoefficientCache
 {
-    return juce::dsp::FilterDesign<float>::designIIRHighpassHighOrderButterworthMethod(chainSettings.lowCutFreq, sampleRate, 2 * (chainSettings.lowCutSlope + 1));
-}
+public:
+    enum class FilterType
+    {
+        Peak,
+        LowCut,
+        HighCut
+    };
+    
+    struct Key
+    {
+        FilterType type;
+        int slope;
+        juce::int64 frequency, quality, gain, sampleRate;
+        
+        bool operator==(const Key &other) const;
+    };
+    
+    struct KeyHash
+    {
+        size_t operator()(const Key &key) const noexcept;
+    };
+    
+    struct Stats
+    {
+        juce::uint64 hits = 0;
+        juce::uint64 misses = 0;
+        size_t size = 0;
+        size_t capacity = 0;
+    };
+    
+    static constexpr size_t defaultCapacity = 256;
+    
+    BiquadCoeffs getPeakFilter(const ChainSettings &chainSettings, double sampleRate);
+    CutCoefficients getLowCutFilter(const ChainSettings &chainSettings, double sampleRate);
+    CutCoefficients getHighCutFilter(const ChainSettings &chainSettings, double sampleRate);
+    
+    void setCapacity(size_t maxEntries);
+    Stats getStats() const;
+private:
+    template<typename DesignFunction>
+    CutCoefficients getOrDesign(const Key &key, DesignFunction &&design);
+    
+    juce::CriticalSection lock;
+    LRUCache<Key, CutCoefficients, KeyHash> cache { defaultCapacity };
+    std::atomic<juce::uint64> hits { 0 }, misses { 0 };
+};
 
-inline auto makeHighCutFilter(const ChainSettings &chainSettings, double sampleRate)
+CoefficientSet makeCoefficientSet(const ChainSettings &chainSettings, double sampleRate, CoefficientCache &cache);
+
+//==============================================================================
+/**
+ Designs the filter coefficients on a background thread whenever one of the
+ filter parameters changes, and hands finished sets to the audio thread through a
+ TripleBuffer. The audio thread only picks up a set when a new one is ready.
+ While linear phase mode is on it also rebuilds the FIR of the LinearPhaseEngine.
+ */
+class CoefficientDesigner : private juce::Thread,
+                            private juce::AudioProcessorValueTreeState::Listener
 {
-    return juce::dsp::FilterDesign<float>::designIIRLowpassHighOrderButterworthMethod(chainSettings.highCutFreq, sampleRate, 2 * (chainSettings.highCutSlope + 1));
-}
+public:
+    CoefficientDesigner(juce::AudioProcessorValueTreeState &apvts, LinearPhaseEngine &linearPhaseEngine);
+    ~CoefficientDesigner() override;
+
+    /** designs a set for the new sample rate right away, call before playback starts. */
+    void prepare(double sampleRate);
+    void requestUpdate();
+
+    /** audio thread: the newest set, or nullptr when nothing changed since the last call. */
+    const CoefficientSet* getNewCoefficients() noexcept { return coefficientSets.getNewestBuffer(); }
+private:
+    void run() override;
+    void parameterChanged(const juce::String &parameterID, float newValue) override;
+    void designAndPublish();
+
+    juce::AudioProcessorValueTreeState &apvts;
+    LinearPhaseEngine &linearPhaseEngine;
+    juce::CriticalSection writerLock;
+    std::atomic<double> sampleRate { 0.0 };
+    std::atomic<bool> needsUpdate { false };
+    TripleBuffer<CoefficientSet> coefficientSets;
+    juce::SharedResourcePointer<CoefficientCache> coefficientCache;
+};
 //==============================================================================
 /**
  */
-class SimpleEQAudioProcessor : public juce::AudioProcessor
+class SimpleEQAudioProcessor : public juce::AudioProcessor,
+                               private juce::Timer
 #if JucePlugin_Enable_ARA
     ,
                                public juce::AudioProcessorARAExtension
@@ -244,6 +287,8 @@ public:
 #endif
 
     void processBlock(juce::AudioBuffer<float> &, juce::MidiBuffer &) override;
+    void processBlock(juce::AudioBuffer<double> &, juce::MidiBuffer &) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor *createEditor() override;
@@ -276,16 +321,69 @@ public:
         "Parameters",
         createParameterLayout()};
     
-    using BlockType = juce::AudioBuffer<float>;
-    SingleChannelSampleFifo<BlockType> leftChannelFifo { Channel::Left };
-    SingleChannelSampleFifo<BlockType> rightChannelFifo { Channel::Right };
+    AnalyzerSettings analyzerSettings;
+    
+    SingleChannelSampleFifo leftChannelFifo { Channel::Left };
+    SingleChannelSampleFifo rightChannelFifo { Channel::Right };
+    
+    /**
+     the FIFOs only feed an analysis client such as the editor's analyzer. The
+     client registers for as long as it reads them, the audio thread only
+     feeds them while it is registered and they only hold memory while it is.
+     Each FIFO is a single-consumer ring, so there can be one client at a
+     time, which holds as JUCE keeps at most one editor per processor.
+     Message thread only.
+     */
+    void addAnalyzerClient();
+    void removeAnalyzerClient();
+    
+    /** the rate of the last prepareToPlay(), 0 before the first. Safe to read from any thread, unlike getSampleRate(). */
+    double getPreparedSampleRate() const noexcept { return preparedSampleRate.load(std::memory_order_acquire); }
+    
+    /** audio thread load and real-time safety violations, all zero unless built with SIMPLEEQ_REALTIME_MONITOR=1. */
+    RealtimeMonitor::Stats getRealtimeStats() const { return realtimeMonitor.getStats(); }
+    void resetRealtimeStats() { realtimeMonitor.reset(); }
 
 private:
-    MonoChain leftChain, rightChain;
-    void updatePeakFilter(const ChainSettings &chainSettings);
-    void updateLowCutFilters(const ChainSettings &chainSettings);
-    void updateHighCutFilters(const ChainSettings &chainSettings);
-    void updateFilters();
+    FilterEngine<float> filterEngine;
+    FilterEngine<double> doublePrecisionFilterEngine;
+    std::atomic<float>* highPrecision = apvts.getRawParameterValue("High Precision");
+    bool usingDoublePrecision = false;
+    template<typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType> &buffer);
+    
+    // index 0 is no oversampling, 1 to 3 are 2x, 4x and 8x
+    static constexpr int numOversamplingOrders = 4;
+    std::array<std::unique_ptr<juce::dsp::Oversampling<float>>, numOversamplingOrders> oversamplers;
+    std::array<std::unique_ptr<juce::dsp::Oversampling<double>>, numOversamplingOrders> doublePrecisionOversamplers;
+    std::array<int, numOversamplingOrders> oversamplingLatencies {};
+    int oversamplingOrder = 0;
+    std::atomic<int> latencyToReport { 0 };
+    std::atomic<bool> latencyChanged { false };
+    template<typename SampleType>
+    juce::dsp::Oversampling<SampleType> &getOversampler(int order);
+    void setOversamplingOrder(int order);
+    
+    // linear phase mode swaps the IIR cascade for an FIR of the same magnitude
+    LinearPhaseEngine linearPhaseEngine;
+    std::atomic<float>* linearPhase = apvts.getRawParameterValue("Linear Phase");
+    bool usingLinearPhase = false;
+    int getLatencyForMode(bool useLinearPhase) const;
+    void setLatencyToReport(int latencyInSamples);
+    void timerCallback() override;
+    CoefficientDesigner coefficientDesigner { apvts, linearPhaseEngine };
+    void updateFilters(const CoefficientSet &coefficientSet);
+    
+    // off -> running when the client registers, running -> stopping when it
+    // leaves, and the audio thread acknowledges with stopping -> off, after
+    // which the FIFOs' memory can go. timerCallback() frees it on the message
+    // thread
+    enum AnalyzerTapState { analyzerTapOff, analyzerTapRunning, analyzerTapStopping };
+    std::atomic<int> analyzerTapState { analyzerTapOff };
+    int numAnalyzerClients = 0;
+    void releaseAnalyzerBuffersIfUnused();
+    RealtimeMonitor realtimeMonitor;
+    std::atomic<double> preparedSampleRate { 0.0 };
     
     juce::dsp::Oscillator<float> osc;
 
@@ -0,0 +1,271 @@
+/*
+  ==============================================================================
+
+    RealtimeMonitor.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeMonitor.h"
+
+#if SIMPLEEQ_REALTIME_MONITOR
+ #include <cstdlib>
+ #include <new>
+ #if JUCE_MAC || JUCE_LINUX
+  #include <dlfcn.h>
+  #include <pthread.h>
+  #include <semaphore.h>
+ #endif
+#endif
+
+namespace
+{
+    // the monitor of the processBlock running on this thread
+    thread_local RealtimeMonitor *activeMonitor = nullptr;
+
+    template<typename T>
+    void storeMax(std::atomic<T> &value, T candidate) noexcept
+    {
+        // only the audio thread writes, a plain compare is enough
+        if (candidate > value.load(std::memory_order_relaxed))
+            value.store(candidate, std::memory_order_relaxed);
+    }
+}
+
+void RealtimeMonitor::prepare(double newSampleRate) noexcept
+{
+    sampleRate.store(newSampleRate);
+}
+
+void RealtimeMonitor::reset() noexcept
+{
+    for (auto &bin : loadHistogram)
+        bin.store(0);
+
+    numBlocks.store(0);
+    deadlineMisses.store(0);
+    allocations.store(0);
+    deallocations.store(0);
+    blockingCalls.store(0);
+    worstLoad.store(0.f);
+    worstSeconds.store(0.0);
+}
+
+RealtimeMonitor::Stats RealtimeMonitor::getStats() const noexcept
+{
+    Stats stats;
+    stats.numBlocks = numBlocks.load();
+    stats.deadlineMisses = deadlineMisses.load();
+    stats.allocations = allocations.load();
+    stats.deallocations = deallocations.load();
+    stats.blockingCalls = blockingCalls.load();
+    stats.worstLoad = worstLoad.load();
+    stats.worstMilliseconds = worstSeconds.load() * 1000.0;
+
+    juce::uint64 total = 0;
+    for (auto &bin : loadHistogram)
+        total += bin.load(std::memory_order_relaxed);
+
+    // the upper edge of the bin holding the 99th percentile
+    juce::uint64 count = 0;
+    for (int i = 0; i < numLoadBins && total > 0; ++i)
+    {
+        count += loadHistogram[(size_t) i].load(std::memory_order_relaxed);
+        if (count * 100 >= total * 99)
+        {
+            stats.p99Load = (float) (i + 1) / 100.f;
+            break;
+        }
+    }
+
+    return stats;
+}
+
+void RealtimeMonitor::recordBlock(int numSamples, juce::int64 ticks) noexcept
+{
+    const auto seconds = juce::Time::highResolutionTicksToSeconds(ticks);
+    const auto deadline = numSamples / sampleRate.load(std::memory_order_relaxed);
+    const auto load = deadline > 0.0 ? (float) (seconds / deadline) : 0.f;
+
+    const auto bin = juce::jlimit(0, numLoadBins - 1, (int) (load * 100.f));
+    loadHistogram[(size_t) bin].fetch_add(1, std::memory_order_relaxed);
+
+    numBlocks.fetch_add(1, std::memory_order_relaxed);
+    if (load > 1.f)
+        deadlineMisses.fetch_add(1, std::memory_order_relaxed);
+
+    storeMax(worstLoad, load);
+    storeMax(worstSeconds, seconds);
+}
+
+#if SIMPLEEQ_REALTIME_MONITOR
+RealtimeMonitor::ScopedBlock::ScopedBlock(RealtimeMonitor &m, int samples) noexcept :
+    monitor(m),
+    previous(activeMonitor),
+    numSamples(samples),
+    start(juce::Time::getHighResolutionTicks())
+{
+    activeMonitor = &monitor;
+}
+
+RealtimeMonitor::ScopedBlock::~ScopedBlock() noexcept
+{
+    monitor.recordBlock(numSamples, juce::Time::getHighResolutionTicks() - start);
+    activeMonitor = previous;
+}
+#endif
+
+void RealtimeMonitor::reportAllocation() noexcept
+{
+    if (auto *monitor = activeMonitor)
+        monitor->allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RealtimeMonitor::reportDeallocation() noexcept
+{
+    if (auto *monitor = activeMonitor)
+        monitor->deallocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+void RealtimeMonitor::reportBlockingCall() noexcept
+{
+    if (auto *monitor = activeMonitor)
+        monitor->blockingCalls.fetch_add(1, std::memory_order_relaxed);
+}
+
+//==============================================================================
+#if SIMPLEEQ_REALTIME_MONITOR
+void *operator new(std::size_t size)
+{
+    RealtimeMonitor::reportAllocation();
+    if (auto *memory = std::malloc(size == 0 ? 1 : size))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) { return operator new(size); }
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    RealtimeMonitor::reportAllocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept { return operator new(size, tag); }
+
+void operator delete(void *memory) noexcept
+{
+    if (memory != nullptr)
+        RealtimeMonitor::reportDeallocation();
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept { operator delete(memory); }
+void operator delete(void *memory, std::size_t) noexcept { operator delete(memory); }
+void operator delete[](void *memory, std::size_t) noexcept { operator delete(memory); }
+void operator delete(void *memory, const std::nothrow_t &) noexcept { operator delete(memory); }
+void operator delete[](void *memory, const std::nothrow_t &) noexcept { operator delete(memory); }
+
+// over-aligned types, e.g. std::vector<juce::dsp::SIMDRegister<float>>, come through these
+namespace
+{
+    void *allocateAligned(std::size_t size, std::align_val_t alignment) noexcept
+    {
+        RealtimeMonitor::reportAllocation();
+        size = size == 0 ? 1 : size;
+       #if JUCE_WINDOWS
+        return _aligned_malloc(size, (std::size_t) alignment);
+       #else
+        void *memory = nullptr;
+        if (posix_memalign(&memory, juce::jmax((std::size_t) alignment, sizeof(void *)), size) != 0)
+            return nullptr;
+        return memory;
+       #endif
+    }
+
+    void freeAligned(void *memory) noexcept
+    {
+        if (memory != nullptr)
+            RealtimeMonitor::reportDeallocation();
+       #if JUCE_WINDOWS
+        _aligned_free(memory);
+       #else
+        std::free(memory);
+       #endif
+    }
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    if (auto *memory = allocateAligned(size, alignment))
+        return memory;
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) { return operator new(size, alignment); }
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocateAligned(size, alignment); }
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept { return allocateAligned(size, alignment); }
+
+void operator delete(void *memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void *memory, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept { freeAligned(memory); }
+void operator delete(void *memory, std::align_val_t, const std::nothrow_t &) noexcept { freeAligned(memory); }
+void operator delete[](void *memory, std::align_val_t, const std::nothrow_t &) noexcept { freeAligned(memory); }
+
+ #if JUCE_MAC || JUCE_LINUX
+namespace
+{
+    /**
+     the real 'name' further down the link order. The pointer is constant
+     initialised, a static with a dynamic initialiser gets a guard that locks
+     a mutex itself.
+     */
+    template<typename Function>
+    Function getNextFunction(Function &next, const char *name) noexcept
+    {
+        if (next == nullptr)
+            next = reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+        return next;
+    }
+}
+
+extern "C" int pthread_mutex_lock(pthread_mutex_t *mutex) noexcept(noexcept(::pthread_mutex_lock(mutex)))
+{
+    static int (*next)(pthread_mutex_t *) = nullptr;
+    RealtimeMonitor::reportBlockingCall();
+    return getNextFunction(next, "pthread_mutex_lock")(mutex);
+}
+
+extern "C" int pthread_rwlock_rdlock(pthread_rwlock_t *lock) noexcept(noexcept(::pthread_rwlock_rdlock(lock)))
+{
+    static int (*next)(pthread_rwlock_t *) = nullptr;
+    RealtimeMonitor::reportBlockingCall();
+    return getNextFunction(next, "pthread_rwlock_rdlock")(lock);
+}
+
+extern "C" int pthread_rwlock_wrlock(pthread_rwlock_t *lock) noexcept(noexcept(::pthread_rwlock_wrlock(lock)))
+{
+    static int (*next)(pthread_rwlock_t *) = nullptr;
+    RealtimeMonitor::reportBlockingCall();
+    return getNextFunction(next, "pthread_rwlock_wrlock")(lock);
+}
+
+extern "C" int sem_wait(sem_t *semaphore) noexcept(noexcept(::sem_wait(semaphore)))
+{
+    static int (*next)(sem_t *) = nullptr;
+    RealtimeMonitor::reportBlockingCall();
+    return getNextFunction(next, "sem_wait")(semaphore);
+}
+
+  #if JUCE_LINUX
+// macOS has no timed mutex lock
+extern "C" int pthread_mutex_timedlock(pthread_mutex_t *mutex, const struct timespec *timeout) noexcept(noexcept(::pthread_mutex_timedlock(mutex, timeout)))
+{
+    static int (*next)(pthread_mutex_t *, const struct timespec *) = nullptr;
+    RealtimeMonitor::reportBlockingCall();
+    return getNextFunction(next, "pthread_mutex_timedlock")(mutex, timeout);
+}
+  #endif
+ #endif
+#endif
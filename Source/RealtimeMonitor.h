@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    RealtimeMonitor.h
+
+    Opt-in real-time safety instrumentation, compiled in when the project is
+    built with SIMPLEEQ_REALTIME_MONITOR=1. Without it every call here is an
+    empty inline function.
+
+    - every processBlock call is timed against its deadline, numSamples /
+      sampleRate, and the load goes into a lock-free histogram
+    - heap allocations and frees made on the audio thread inside processBlock
+      are counted, through replacements of the global operator new and delete,
+      the aligned ones included
+    - blocking calls are counted the same way, through wrappers around
+      pthread_mutex_lock, pthread_mutex_timedlock (Linux only),
+      pthread_rwlock_rdlock/wrlock and sem_wait on macOS and Linux, which is
+      what juce::CriticalSection, std::mutex, std::shared_mutex and
+      juce::WaitableEvent end up in
+
+    Not seen: malloc called directly, waits on a pthread_cond_t, which the C
+    library takes its mutex for internally, os_unfair_lock and other
+    platform locks that don't go through pthreads, and anything on Windows
+    apart from the allocations.
+
+    The counters only ever see the thread that is inside a ScopedBlock, so the
+    designer thread or the editor can allocate and lock as much as they like.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <array>
+#include <atomic>
+
+#ifndef SIMPLEEQ_REALTIME_MONITOR
+ #define SIMPLEEQ_REALTIME_MONITOR 0
+#endif
+
+class RealtimeMonitor
+{
+public:
+    static constexpr bool isEnabled = SIMPLEEQ_REALTIME_MONITOR != 0;
+
+    struct Stats
+    {
+        juce::uint64 numBlocks = 0;
+        juce::uint64 deadlineMisses = 0;
+        juce::uint64 allocations = 0;
+        juce::uint64 deallocations = 0;
+        juce::uint64 blockingCalls = 0;
+
+        /** processing time as a fraction of the block's deadline, p99 in 1% steps. */
+        float worstLoad = 0.f;
+        float p99Load = 0.f;
+        double worstMilliseconds = 0.0;
+    };
+
+    void prepare(double sampleRate) noexcept;
+
+    /** starts counting from zero, call from the message thread. */
+    void reset() noexcept;
+
+    /** a snapshot for the editor or any other reader, safe from any thread. */
+    Stats getStats() const noexcept;
+
+    /** marks the calling thread as being inside processBlock and times the call. */
+    struct ScopedBlock
+    {
+#if SIMPLEEQ_REALTIME_MONITOR
+        ScopedBlock(RealtimeMonitor &monitor, int numSamples) noexcept;
+        ~ScopedBlock() noexcept;
+    private:
+        RealtimeMonitor &monitor;
+        RealtimeMonitor *previous;
+        int numSamples;
+        juce::int64 start;
+#else
+        ScopedBlock(RealtimeMonitor &, int) noexcept { }
+#endif
+    };
+
+    /** called by the hooks, counted against the processBlock running on this thread, if any. */
+    static void reportAllocation() noexcept;
+    static void reportDeallocation() noexcept;
+    static void reportBlockingCall() noexcept;
+private:
+    void recordBlock(int numSamples, juce::int64 ticks) noexcept;
+
+    // 1% steps up to 200%, the last bin takes everything above
+    static constexpr int numLoadBins = 201;
+    std::array<std::atomic<juce::uint32>, numLoadBins> loadHistogram {};
+
+    std::atomic<juce::uint64> numBlocks { 0 }, deadlineMisses { 0 };
+    std::atomic<juce::uint64> allocations { 0 }, deallocations { 0 }, blockingCalls { 0 };
+    std::atomic<float> worstLoad { 0.f };
+    std::atomic<double> worstSeconds { 0.0 };
+    std::atomic<double> sampleRate { 44100.0 };
+};
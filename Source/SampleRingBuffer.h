@@ -0,0 +1,102 @@
+/*
+  ==============================================================================
+
+    SampleRingBuffer.h
+
+    Lock-free single-producer / single-consumer ring of float samples. The
+    writer copies whole blocks in with at most two bulk copies, the reader
+    gets the ready samples as at most two contiguous spans straight out of
+    the ring, so neither side copies more than once or ever allocates.
+
+    When the ring is full the writer drops what doesn't fit; the reader can
+    skip over samples it has no use for to make room.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+struct SampleRingBuffer
+{
+    /**
+     makes room for at least 'minimumCapacity' samples and empties the ring.
+     Only allocates when the ring has to grow, and isn't safe while either
+     side is running when it does.
+     */
+    void prepare(int minimumCapacity)
+    {
+        const auto size = juce::nextPowerOfTwo(minimumCapacity + 1);
+        if ((int) samples.size() < size)
+        {
+            samples.assign((size_t) size, 0.f);
+            fifo.setTotalSize(size);
+        }
+        fifo.reset();
+    }
+
+    /** frees the memory, the ring takes nothing until the next prepare(). Same rules as prepare(). */
+    void release()
+    {
+        std::vector<float>().swap(samples);
+        fifo.setTotalSize(1);
+    }
+
+    int getCapacity() const noexcept { return (int) samples.size(); }
+
+    /** writer side: returns how many samples went in. */
+    template<typename SampleType>
+    int write(const SampleType* source, int numSamples) noexcept
+    {
+        const auto scope = fifo.write(numSamples);
+        copy(source, scope.startIndex1, scope.blockSize1);
+        copy(source + scope.blockSize1, scope.startIndex2, scope.blockSize2);
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    /** reader side: how many samples are ready. */
+    int getNumReady() const noexcept { return fifo.getNumReady(); }
+
+    /**
+     reader side: calls 'useSpan(const float*, int)' for the oldest
+     'numSamples' ready samples, in order, then hands their space back to the
+     writer. The pointers are only valid during the call.
+     */
+    template<typename Function>
+    int read(int numSamples, Function&& useSpan)
+    {
+        const auto scope = fifo.read(numSamples);
+        if (scope.blockSize1 > 0)
+            useSpan(samples.data() + scope.startIndex1, scope.blockSize1);
+        if (scope.blockSize2 > 0)
+            useSpan(samples.data() + scope.startIndex2, scope.blockSize2);
+        return scope.blockSize1 + scope.blockSize2;
+    }
+
+    /** reader side: drops the oldest 'numSamples' ready samples unread. */
+    void skip(int numSamples) noexcept
+    {
+        fifo.finishedRead(juce::jlimit(0, fifo.getNumReady(), numSamples));
+    }
+private:
+    template<typename SampleType>
+    void copy(const SampleType* source, int startIndex, int numSamples) noexcept
+    {
+        if (numSamples <= 0)
+            return;
+
+        auto* destination = samples.data() + startIndex;
+        if constexpr (std::is_same_v<SampleType, float>)
+            juce::FloatVectorOperations::copy(destination, source, numSamples);
+        else
+            std::transform(source, source + numSamples, destination,
+                           [](SampleType sample) { return static_cast<float>(sample); });
+    }
+
+    std::vector<float> samples;
+    juce::AbstractFifo fifo { 1 };
+};
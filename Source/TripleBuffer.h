@@ -0,0 +1,54 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+
+    Lock-free single-writer / single-reader triple buffer. The writer fills
+    the back buffer and publishes it, the reader picks up the newest published
+    buffer by swapping indices. Neither side ever waits for the other.
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+template<typename T>
+struct TripleBuffer
+{
+    /**
+     writer side: the buffer that will be handed over on the next publish().
+     */
+    T& getWriteBuffer() noexcept { return buffers[back]; }
+
+    void publish() noexcept
+    {
+        back = middle.exchange(back | freshBit, std::memory_order_acq_rel) & indexMask;
+    }
+
+    /**
+     reader side: returns the newest published buffer, or nullptr if nothing
+     was published since the last call. The returned buffer stays untouched by
+     the writer until the next call.
+     */
+    const T* getNewestBuffer() noexcept
+    {
+        if ((middle.load(std::memory_order_relaxed) & freshBit) == 0)
+            return nullptr;
+
+        front = middle.exchange(front, std::memory_order_acq_rel) & indexMask;
+        return &buffers[front];
+    }
+
+    const T& getReadBuffer() const noexcept { return buffers[front]; }
+private:
+    static constexpr int indexMask = 3;
+    static constexpr int freshBit = 4;
+
+    std::array<T, 3> buffers;
+    int back = 0;
+    std::atomic<int> middle { 1 };
+    int front = 2;
+};